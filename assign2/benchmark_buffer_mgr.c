@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+/* Heap allocations and time per buffer pool miss.
+ *
+ * usage: benchmark_buffer_mgr [pages [frames [pins]]]
+ *
+ * Pins the pages of a file round robin through a FIFO pool with fewer frames
+ * than pages, so every pin misses and replaces a frame. malloc, calloc and
+ * realloc are counted by wrapping glibc's own allocator, everything a miss
+ * allocates is counted. It should be zero: the pool keeps its page file open and
+ * misses read straight into the victim frame.
+ */
+
+#define BENCH_FILE "benchmark_buffer.bin"
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static long allocations = 0;
+
+void *
+malloc(size_t size)
+{
+  allocations++;
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t count, size_t size)
+{
+  allocations++;
+  return __libc_calloc(count, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  allocations++;
+  return __libc_realloc(ptr, size);
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int pages = argc > 1 ? atoi(argv[1]) : 64;
+  int frames = argc > 2 ? atoi(argv[2]) : 16;
+  long pins = argc > 3 ? atol(argv[3]) : 20000;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  long i, before, poolAllocations, misses;
+  double start, elapsed;
+
+  if (pages <= frames)
+    {
+      printf("need more pages than frames for every pin to miss\n");
+      return 1;
+    }
+
+  initStorageManager();
+
+  // Write the file through a pool, the way the buffer manager tests create their pages
+  if (createPageFile (BENCH_FILE) != RC_OK || initBufferPool (bm, BENCH_FILE, frames, RS_FIFO, NULL) != RC_OK)
+    {
+      printf("cannot create %s\n", BENCH_FILE);
+      return 1;
+    }
+  for (i = 0; i < pages; i++)
+    {
+      pinPage (bm, h, i);
+      sprintf(h->data, "%s-%li", "Page", i);
+      markDirty (bm, h);
+      unpinPage (bm, h);
+    }
+  shutdownBufferPool (bm);
+
+  // Every pin misses: the pool holds fewer frames than the scan touches pages
+  initBufferPool (bm, BENCH_FILE, frames, RS_FIFO, NULL);
+  for (i = 0; i < frames; i++)
+    {
+      pinPage (bm, h, i);
+      unpinPage (bm, h);
+    }
+  misses = getNumReadIO (bm);
+  before = allocations;
+  start = now();
+  for (i = 0; i < pins; i++)
+    {
+      pinPage (bm, h, (frames + i) % pages);
+      unpinPage (bm, h);
+    }
+  elapsed = now() - start;
+  poolAllocations = allocations - before;
+  misses = getNumReadIO (bm) - misses;
+  shutdownBufferPool (bm);
+  destroyPageFile (BENCH_FILE);
+
+  printf("%d pages, %d frames, %ld pins, %ld misses\n", pages, frames, pins, misses);
+  printf("%-28s %10.2f\n", "allocations per miss", (double) poolAllocations / misses);
+  printf("%-28s %10.2f\n", "microseconds per miss", elapsed * 1e6 / misses);
+
+  free(bm);
+  free(h);
+  return 0;
+}
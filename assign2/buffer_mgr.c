@@ -19,36 +19,37 @@ int bufferSize = 0;
 int numReadIO = 0;
 int numWriteIO = 0;
 int hit;
+static SM_FileHandle pageFile; // The pool's page file, opened once by initBufferPool and closed by shutdownBufferPool
 
-void pinPageFIFO(BM_BufferPool *const bm, PageFrame *page)
+// Write a victim frame's page back to disk if a client modified it, so the frame's memory can be reused for another page
+static void writeBackFrame(BM_BufferPool *const bm, PageFrame *frame)
+{
+	if(frame->dirtyFlag == 1)
+	{
+		writeBlock(frame->pageNum, &pageFile, frame->data);
+		frame->dirtyFlag = 0;
+
+		// Increase the writeCount which records the number of writes done by the buffer manager.
+		numWriteIO++;
+	}
+}
+
+// Pick the frame to replace in FIFO order. Returns -1 if every frame is pinned.
+int pinPageFIFO(BM_BufferPool *const bm)
 {
     //printf("FIFO Started");
 	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
 	
-	int next = numReadIO % bufferSize;
+	// Frames are taken in turn, one per read. The miss asking for a frame is the next read.
+	int next = (numReadIO + 1) % bufferSize;
 
 	// Interating through all the page frames in the buffer pool
 	for(int i = 0; i < bufferSize; i++)
 	{
 		if(pageFrame[next].fixCount == 0)
 		{
-			// If page in memory has been modified (dirtyBit = 1), then write page to disk
-			if(pageFrame[next].dirtyFlag == 1)
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pageFrame[next].pageNum, &fh, pageFrame[next].data);
-				
-				// Increase the writeCount which records the number of writes done by the buffer manager.
-				numWriteIO++;
-			}
-			
-			// Setting page frame's content to new page's content
-			pageFrame[next].data = page->data;
-			pageFrame[next].pageNum = page->pageNum;
-			pageFrame[next].dirtyFlag = page->dirtyFlag;
-			pageFrame[next].fixCount = page->fixCount;
-			break;
+			writeBackFrame(bm, &pageFrame[next]);
+			return next;
 		}
 		else
 		{
@@ -57,58 +58,36 @@ void pinPageFIFO(BM_BufferPool *const bm, PageFrame *page)
 			next = (next % bufferSize == 0) ? 0 : next;
 		}
 	}
-
+	return -1;
 }
 
-void pinPageLRU(BM_BufferPool *const bm, PageFrame *page) {
+// Pick the least recently used unpinned frame. Returns -1 if every frame is pinned.
+int pinPageLRU(BM_BufferPool *const bm) {
     PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	int i, leastHitIndex, leastHitNum;
+	int i, leastHitIndex = -1, leastHitNum = 0;
 
-	// Interating through all the page frames in the buffer pool.
+	// Finding the unpinned page frame having minimum hitNum (i.e. it is the least recently used) page frame
 	for(i = 0; i < bufferSize; i++)
 	{
-		// Finding page frame whose fixCount = 0 i.e. no client is using that page frame.
-		if(pageFrame[i].fixCount == 0)
+		if(pageFrame[i].fixCount == 0 && (leastHitIndex == -1 || pageFrame[i].hitNum < leastHitNum))
 		{
 			leastHitIndex = i;
 			leastHitNum = pageFrame[i].hitNum;
-			break;
 		}
-	}	
-
-	// Finding the page frame having minimum hitNum (i.e. it is the least recently used) page frame
-	for(i = leastHitIndex + 1; i < bufferSize; i++)
-	{
-		if(pageFrame[i].hitNum < leastHitNum)
-		{
-			leastHitIndex = i;
-			leastHitNum = pageFrame[i].hitNum;
-		}
-	}
-
-	// If page in memory has been modified (dirtyFlag == true), then write page to disk
-	if(pageFrame[leastHitIndex].dirtyFlag == true)
-	{
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(pageFrame[leastHitIndex].pageNum, &fh, pageFrame[leastHitIndex].data);
-		
-		// Increase the writeCount which records the number of writes done by the buffer manager.
-		numWriteIO++;
 	}
-	
-	// Setting page frame's content to new page's content
-	pageFrame[leastHitIndex].data = page->data;
-	pageFrame[leastHitIndex].pageNum = page->pageNum;
-	pageFrame[leastHitIndex].dirtyFlag = page->dirtyFlag;
-	pageFrame[leastHitIndex].fixCount = page->fixCount;
-	pageFrame[leastHitIndex].hitNum = page->hitNum;
 
+	if(leastHitIndex != -1)
+		writeBackFrame(bm, &pageFrame[leastHitIndex]);
+	return leastHitIndex;
 }
 
 // Initialize the buffer pool
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData) {
    
+    // The page file stays open for the pool's whole life, a miss only reads from it
+    if (openPageFile((char *) pageFileName, &pageFile) != RC_OK)
+        return RC_FILE_NOT_FOUND;
+
     // Allocate memory for the page file name and copy it
     bm->pageFile = (char *) (char *)pageFileName;
     
@@ -153,10 +132,12 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
 		}
 	}
 
-	// Releasing space occupied by the page
+	// Releasing the frames' memory and the frames themselves
+	for(i = 0; i < bufferSize; i++)
+		free(pageFrame[i].data);
 	free(pageFrame);
 	bm->mgmtData = NULL;
-	return RC_OK;
+	return closePageFile(&pageFile);
 }
 
 
@@ -169,9 +150,7 @@ RC forceFlushPool(BM_BufferPool *const bm)
 	{
 		if(pageFrame[i].fixCount == 0 && pageFrame[i].dirtyFlag)
 		{
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
+			writeBlock(pageFrame[i].pageNum, &pageFile, pageFrame[i].data);
 			// Mark the page as not dirty
 			pageFrame[i].dirtyFlag = false;
 			numWriteIO++;
@@ -225,9 +204,7 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
     // Loop again for the page we are looking for...
     for (int i = 0; i < bufferSize; i++) {
         if (pageFrame[i].pageNum == page->pageNum) {
-            SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
+			writeBlock(pageFrame[i].pageNum, &pageFile, pageFrame[i].data);
             // If dirty flag is true...
             // Writing the page back to disk
             numWriteIO++; // Incrementing write IO count...
@@ -248,11 +225,8 @@ extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 	if(pageFrame[0].pageNum == -1)
 	{
 		// Reading page from disk. Initializing page frame's content in the buffer pool
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		pageFrame[0].data = (SM_PageHandle) malloc(PAGE_SIZE);
-		ensureCapacity(pageNum,&fh);
-		readBlock(pageNum, &fh, pageFrame[0].data);
+		ensureCapacity(pageNum,&pageFile);
+		readBlock(pageNum, &pageFile, pageFrame[0].data);
 		pageFrame[0].pageNum = pageNum;
 		pageFrame[0].fixCount++;
 		numReadIO = hit = 0;
@@ -288,10 +262,8 @@ extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 					break;
 				}				
 			} else {
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				pageFrame[i].data = (SM_PageHandle) malloc(PAGE_SIZE);
-				readBlock(pageNum, &fh, pageFrame[i].data);
+				// Read straight into the frame's preallocated memory
+				readBlock(pageNum, &pageFile, pageFrame[i].data);
 				pageFrame[i].pageNum = pageNum;
 				pageFrame[i].fixCount = 1;
 				numReadIO++;	
@@ -315,40 +287,39 @@ extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 		// If isBufferFull = true, then it means that the buffer is full and we must replace an existing page using page replacement strategy
 		if(isBufferFull == true)
 		{
-			// Create a new page to store data read from the file.
-			PageFrame *newPage = (PageFrame *) malloc(sizeof(PageFrame));		
-			
-			// Reading page from disk and initializing page frame's content in the buffer pool
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			newPage->data = (SM_PageHandle) malloc(PAGE_SIZE);
-			readBlock(pageNum, &fh, newPage->data);
-			newPage->pageNum = pageNum;
-			newPage->dirtyFlag = 0;		
-			newPage->fixCount = 1;
-			numReadIO++;
-			hit++;
-			if(bm->strategy == RS_LRU)
-				// LRU algorithm uses the value of hit to determine the least recently used page
-				newPage->hitNum = hit;				
-			page->pageNum = pageNum;
-			page->data = newPage->data;			
+			int victim;
 
 			// Call appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
 			switch(bm->strategy)
 			{			
 				case RS_FIFO: // Using FIFO algorithm
-					pinPageFIFO(bm, newPage);
+					victim = pinPageFIFO(bm);
 					break;
 				
 				case RS_LRU: // Using LRU algorithm
-					pinPageLRU(bm, newPage);
+					victim = pinPageLRU(bm);
 					break;
 				default:
 					printf("\nAlgorithm Not Implemented\n");
-					break;
+					return RC_STRATEGY_NOT_SUPPORTED;
 			}
-						
+			if(victim == -1)
+				return RC_ALL_FRAMES_PINNED;
+
+			// Only a miss that gets a frame reads a page
+			numReadIO++;
+			hit++;
+
+			// Reading page from disk straight into the victim frame's memory, which the frames own for the pool's whole life
+			readBlock(pageNum, &pageFile, pageFrame[victim].data);
+			pageFrame[victim].pageNum = pageNum;
+			pageFrame[victim].dirtyFlag = 0;
+			pageFrame[victim].fixCount = 1;
+			if(bm->strategy == RS_LRU)
+				// LRU algorithm uses the value of hit to determine the least recently used page
+				pageFrame[victim].hitNum = hit;
+			page->pageNum = pageNum;
+			page->data = pageFrame[victim].data;
 		}		
 		return RC_OK;
 	}	
@@ -36,31 +36,41 @@ RC createPageFile(char *fileName) {
     return RC_OK;
 }
 
-// Open an existing page file
+// Open an existing page file. The stream stays open in the handle until closePageFile, so reading
+// a block does not open the file again.
 RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
 
     filePointer = fopen(fileName, "r+");    // Opening the file
     if (filePointer == NULL)                       // :(
         return RC_FILE_NOT_FOUND;
+
+    // Unbuffered: blocks are read whole, and other streams writing the file are never hidden behind a stale buffer
+    setvbuf(filePointer, NULL, _IONBF, 0);
     
     // But if again successful...
     fHandle->fileName = fileName;
 	fHandle->curPagePos = 0;
 
 	struct stat fileInfo;
-	if(fstat(fileno(filePointer), &fileInfo) < 0)
+	if(fstat(fileno(filePointer), &fileInfo) < 0) {
+		fclose(filePointer);
 		return RC_FILE_NOT_FOUND;
+	}
 	fHandle->totalNumPages = fileInfo.st_size/PAGE_SIZE;
-
-	fclose(filePointer);
+	fHandle->mgmtInfo = filePointer;
 
 	return RC_OK;
 }
 
 // Close the page file
 RC closePageFile(SM_FileHandle *fHandle) {
-    filePointer = fopen(fHandle->fileName, "r+");    // Opening the file
-    int fileClosed = fclose(filePointer);           // Return code to store value of fclose
+    if (fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    if (filePointer == fHandle->mgmtInfo)
+        filePointer = NULL;
+    int fileClosed = fclose((FILE *) fHandle->mgmtInfo);   // Return code to store value of fclose
+    fHandle->mgmtInfo = NULL;
 	if (fileClosed != 0)                            // If not closed due to fclose failing...
 		return RC_FILE_NOT_FOUND;           
     return RC_OK;                                   // File successfully closed
@@ -88,31 +98,38 @@ RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
 	if (pageNum > fHandle->totalNumPages || pageNum < 0)
         	return RC_READ_NON_EXISTING_PAGE;
 
-	// Opening file stream in read mode. 'r' mode opens file for reading only.	
-	filePointer = fopen(fHandle->fileName, "r");
+	// The handle's own stream when it has one, otherwise a stream opened for this read
+	FILE *stream = (FILE *) fHandle->mgmtInfo;
+	if(stream == NULL) {
+		// Opening file stream in read mode. 'r' mode opens file for reading only.	
+		filePointer = fopen(fHandle->fileName, "r");
 
-	// Checking if file was successfully opened.
-	if(filePointer == NULL)
-		return RC_FILE_NOT_FOUND;
+		// Checking if file was successfully opened.
+		if(filePointer == NULL)
+			return RC_FILE_NOT_FOUND;
+		stream = filePointer;
+	}
 	
 	// Setting the cursor(pointer) position of the file stream. Position is calculated by Page Number x Page Size
 	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(filePointer, (pageNum * PAGE_SIZE), SEEK_SET);
+	RC rc = RC_OK;
+	int isSeekSuccess = fseek(stream, (pageNum * PAGE_SIZE), SEEK_SET);
 	if(isSeekSuccess == 0) {
 		// We're reading the content and storing it in the location pointed out by memPage.
-		if(fread(memPage, sizeof(char), PAGE_SIZE, filePointer) < PAGE_SIZE)
-			return RC_FILE_NOT_FOUND;
+		if(fread(memPage, sizeof(char), PAGE_SIZE, stream) < PAGE_SIZE)
+			rc = RC_FILE_NOT_FOUND;
+		else
+			// Setting the current page position to the cursor(pointer) position of the file stream
+			fHandle->curPagePos = ftell(stream); 
 	} else {
-		return RC_READ_NON_EXISTING_PAGE; 
+		rc = RC_READ_NON_EXISTING_PAGE; 
 	}
-    	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(filePointer); 
 	
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(filePointer);
+	// Closing a stream opened for this read so that all the buffers are flushed.     	
+	if(stream != fHandle->mgmtInfo)
+		fclose(stream);
 	
-    	return RC_OK;
+    	return rc;
 
 }
 
@@ -235,14 +252,15 @@ RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
 // Append an empty block at the end of the file
 RC appendEmptyBlock(SM_FileHandle *fHandle) {
     SM_PageHandle emptyBlock = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
+	FILE *stream = fHandle->mgmtInfo != NULL ? (FILE *) fHandle->mgmtInfo : filePointer;
 	
 	// Moving the cursor (pointer) position to the begining of the file stream.
 	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(filePointer, 0, SEEK_END);
+	int isSeekSuccess = fseek(stream, 0, SEEK_END);
 	
 	if( isSeekSuccess == 0 ) {
 		// Writing an empty page to the file
-		fwrite(emptyBlock, sizeof(char), PAGE_SIZE, filePointer);
+		fwrite(emptyBlock, sizeof(char), PAGE_SIZE, stream);
 	} else {
 		free(emptyBlock);
 		return RC_WRITE_FAILED;
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "storage_mgr.h"
+#include "dberror.h"
+
+/* Read throughput of threads sharing one page file handle.
+ *
+ * usage: benchmark_storage_mgr [pages [reads per thread [max threads [file name]]]]
+ *
+ * Every thread reads random pages of the same file with readBlock. With the
+ * storage manager keeping all state per handle and reading with pread, the
+ * throughput should grow with the number of threads up to the number of cores.
+ * A file name starting with SM_MEMORY_PREFIX measures the CPU cost alone.
+ */
+
+#define BENCH_FILE "benchmark_pagefile.bin"
+
+typedef struct BenchWork {
+  SM_FileHandle *fh;
+  long reads;
+  unsigned int seed;
+  long failures;
+} BenchWork;
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+readWorker(void *arg)
+{
+  BenchWork *work = (BenchWork *) arg;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  long i;
+
+  for (i = 0; i < work->reads; i++)
+    {
+      SM_BlockNum page = rand_r(&work->seed) % work->fh->totalNumPages;
+      if (readBlock (page, work->fh, ph) != RC_OK || ph[0] != (char) page)
+        work->failures++;
+    }
+  free(ph);
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  long pages = argc > 1 ? atol(argv[1]) : 16384;
+  long reads = argc > 2 ? atol(argv[2]) : 200000;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int maxThreads = argc > 3 ? atoi(argv[3]) : (int) (cores > 0 ? 2 * cores : 2);
+  char *fileName = argc > 4 ? argv[4] : BENCH_FILE;
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  double baseline = 0;
+  long i;
+  int threads;
+
+  initStorageManager();
+
+  // Write a file whose pages say which page they are
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  if (createPageFile (fileName) != RC_OK || openPageFile (fileName, &fh) != RC_OK || ensureCapacity (pages, &fh) != RC_OK)
+    {
+      printf("cannot create %s\n", fileName);
+      return 1;
+    }
+  for (i = 0; i < pages; i++)
+    {
+      memset(ph, (char) i, PAGE_SIZE);
+      writeBlock (i, &fh, ph);
+    }
+  free(ph);
+
+  printf("%s: %ld pages of %d bytes, %ld random reads per thread, %ld cores\n", fileName, pages, PAGE_SIZE, reads, cores);
+  printf("%8s %14s %10s\n", "threads", "reads/s", "speedup");
+
+  for (threads = 1; threads <= maxThreads; threads *= 2)
+    {
+      pthread_t *ids = (pthread_t *) malloc(threads * sizeof(pthread_t));
+      BenchWork *work = (BenchWork *) malloc(threads * sizeof(BenchWork));
+      long failures = 0;
+      double start = now();
+
+      for (i = 0; i < threads; i++)
+        {
+          work[i].fh = &fh;
+          work[i].reads = reads;
+          work[i].seed = (unsigned int) i + 1;
+          work[i].failures = 0;
+          pthread_create(&ids[i], NULL, readWorker, &work[i]);
+        }
+      for (i = 0; i < threads; i++)
+        {
+          pthread_join(ids[i], NULL);
+          failures += work[i].failures;
+        }
+
+      double rate = threads * reads / (now() - start);
+      if (threads == 1)
+        baseline = rate;
+      printf("%8d %14.0f %9.2fx%s\n", threads, rate, rate / baseline, failures > 0 ? "  (reads failed)" : "");
+      free(ids);
+      free(work);
+    }
+
+  closePageFile (&fh);
+  destroyPageFile (fileName);
+  return 0;
+}
@@ -1,5 +1,5 @@
 #include "btree_mgr.h"
-#include <buffer_mgr.h>
+#include "buffer_mgr.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -15,7 +15,6 @@ IndexManager* index_mgr;  // Global pointer to BTree Manager
 
 //Constants
 #define MAX_NUMBER_OF_PAGES 10
-#define PAGE_SIZE 4096  // Example size for pages, adjust as needed
 
 // init and shutdown index manager
 RC initIndexManager(void *mgmtData) {
@@ -55,6 +54,11 @@ RC shutdownIndexManager() {
     // |-----------------------|
 
 RC createBtree(char *idxId, DataType keyType, int n) {
+    return createBtreeWithPageSize(idxId, keyType, n, PAGE_SIZE);
+}
+
+// Same as createBtree with pages of pageSize bytes, small pages suit indexes used for point lookups
+RC createBtreeWithPageSize(char *idxId, DataType keyType, int n, int pageSize) {
     if (idxId == NULL || keyType != DT_INT || n < 0) return -99;
 
     // Initialize the buffer pool directly (no need for malloc, as bufferPool is not a pointer)
@@ -65,7 +69,12 @@ RC createBtree(char *idxId, DataType keyType, int n) {
         return rc;
     }
 
-    char data[PAGE_SIZE];
+    char *data = (char *) calloc(1, pageSize);
+    if (data == NULL) {
+        printf("Error: Failed to allocate memory for the index header page.\n");
+        shutdownBufferPool(&index_mgr->bufferPool);
+        return -99;
+    }
     char *page_handle_ptr = data;
 
     *(int *)page_handle_ptr = 1;  // We initialize with 1 node (root)
@@ -84,6 +93,7 @@ RC createBtree(char *idxId, DataType keyType, int n) {
     Node *rootNode = malloc(sizeof(Node));
     if (rootNode == NULL) {
         printf("Error: Failed to allocate memory for root node.\n");
+        free(data);
         shutdownBufferPool(&index_mgr->bufferPool);
         return -99;
     }
@@ -92,6 +102,7 @@ RC createBtree(char *idxId, DataType keyType, int n) {
     rootNode->keys = (DataType *)calloc(n, sizeof(DataType));
     if (rootNode->keys == NULL) {
         printf("Error: Failed to allocate memory for root node keys.\n");
+        free(data);
         free(rootNode);
         shutdownBufferPool(&index_mgr->bufferPool);
         return -99;
@@ -101,6 +112,7 @@ RC createBtree(char *idxId, DataType keyType, int n) {
     rootNode->children = (Node **)calloc(n + 1, sizeof(Node *));
     if (rootNode->children == NULL) {
         printf("Error: Failed to allocate memory for root node children.\n");
+        free(data);
         free(rootNode->keys);
         free(rootNode);
         shutdownBufferPool(&index_mgr->bufferPool);
@@ -134,20 +146,24 @@ RC createBtree(char *idxId, DataType keyType, int n) {
     index_mgr->rootNode = *rootNode;
 
     SM_FileHandle fileHandle;
-    rc = createPageFile(idxId);
+    SM_FileOptions options = { .pageSize = pageSize };
+    rc = createPageFileOptions(idxId, &options);
     if (rc != RC_OK) {
         printf("Error: Failed to create page file '%s' with error code %d.\n", idxId, rc);
+        free(data);
         return rc;
     }
 
     rc = openPageFile(idxId, &fileHandle);
     if (rc != RC_OK) {
         printf("Error: Failed to open page file '%s' with error code %d.\n", idxId, rc);
+        free(data);
         return rc;
     }
 
     SM_PageHandle pageHandle = data;  // Point to data directly
     rc = writeBlock(0, &fileHandle, pageHandle);
+    free(data);
     if (rc != RC_OK) {
         printf("Error: Failed to write to block 0 of file '%s' with error code %d.\n", idxId, rc);
         closePageFile(&fileHandle);
@@ -192,7 +208,7 @@ RC openBtree(BTreeHandle **tree, char *idxId) {
     }
 
     // Read the first page to retrieve metadata
-    SM_PageHandle pageData = (SM_PageHandle)malloc(PAGE_SIZE);
+    SM_PageHandle pageData = (SM_PageHandle)malloc(fileHandle.pageSize);
     if (readBlock(0, &fileHandle, pageData) != RC_OK) {
         printf("Error: Failed to read metadata from index file.\n");
         free(pageData);
@@ -43,6 +43,7 @@ extern RC shutdownIndexManager ();
 
 // create, destroy, open, and close an btree index
 extern RC createBtree (char *idxId, DataType keyType, int n);
+extern RC createBtreeWithPageSize (char *idxId, DataType keyType, int n, int pageSize);
 extern RC openBtree (BTreeHandle **tree, char *idxId);
 extern RC closeBtree (BTreeHandle *tree);
 extern RC deleteBtree (char *idxId);
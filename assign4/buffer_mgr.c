@@ -1,16 +1,576 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include "buffer_mgr_stat.h"
 #include "buffer_mgr.h"
+#include "storage_mgr_stat.h"
 
-#define MAX_ALLOWED_PAGES 1000  // or a suitable upper limit
+// Get the page file of the pool, opening it the first time it is needed.
+// The pool can be initialized before its page file is created, so the frames
+// are only allocated here once the page size of the file is known.
+static SM_FileHandle *getPoolFile(BM_BufferPool *const bm) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    if (mgmtData->fileHandle.mgmtInfo != NULL)
+        return &mgmtData->fileHandle;
+    if (openPageFileMode(bm->pageFile, &mgmtData->fileHandle, mgmtData->ioMode) != RC_OK)
+        return NULL;
+
+    // Page aligned memory for all frames in one block, O_DIRECT reads and writes straight into it
+    int pageSize = mgmtData->fileHandle.pageSize;
+    if (mgmtData->frameMemory == NULL) {
+        void *frameMemory = NULL;
+        if (posix_memalign(&frameMemory, SM_MIN_PAGE_SIZE, (size_t) bm->numPages * pageSize) != 0) {
+            closePageFile(&mgmtData->fileHandle);
+            return NULL;
+        }
+        mgmtData->frameMemory = frameMemory;
+        mgmtData->pageSize = pageSize;
+        for (int i = 0; i < bm->numPages; i++)
+            mgmtData->pageFrames[i].data = (char *) frameMemory + (size_t) i * pageSize;
+    }
+    return &mgmtData->fileHandle;
+}
+
+// Load a page from disk into a frame, growing the file if the page does not exist yet
+static RC readPoolPage(BM_BufferPool *const bm, BM_PageHandle *frame, const PageNumber pageNum) {
+    SM_FileHandle *fh = getPoolFile(bm);
+    if (fh == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    RC rc = ensureCapacity(pageNum + 1, fh);
+    if (rc != RC_OK)
+        return rc;
+    return readBlock(pageNum, fh, frame->data);
+}
+
+// Make a page map with room for at least capacity pages, twice as many slots keep the probe runs short
+static void pageMapInit(BM_PageMap *map, int capacity) {
+    map->bits = 1;
+    while ((1 << map->bits) < 2 * capacity)
+        map->bits++;
+    map->slots = malloc(((size_t) 1 << map->bits) * sizeof(BM_PageMapSlot));
+    for (int slot = 0; slot < (1 << map->bits); slot++)
+        map->slots[slot].value = -1;
+}
+
+// Slot where the search for a page starts, multiplicative hashing spreads neighbouring
+// page numbers over the whole table
+static int pageMapHome(BM_PageMap *map, const PageNumber pageNum) {
+    return (int) (((uint32_t) pageNum * 2654435761u) >> (32 - map->bits));
+}
+
+// Slot holding a page, -1 if the page is not in the map
+static int pageMapSlot(BM_PageMap *map, const PageNumber pageNum) {
+    int mask = (1 << map->bits) - 1;
+    for (int slot = pageMapHome(map, pageNum); map->slots[slot].value >= 0; slot = (slot + 1) & mask) {
+        if (map->slots[slot].pageNum == pageNum)
+            return slot;
+    }
+    return -1;
+}
+
+// Value stored for a page, -1 if the page is not in the map
+static int pageMapGet(BM_PageMap *map, const PageNumber pageNum) {
+    int slot = pageMapSlot(map, pageNum);
+    return (slot < 0) ? -1 : map->slots[slot].value;
+}
+
+// Enter a page that is not in the map yet
+static void pageMapPut(BM_PageMap *map, const PageNumber pageNum, int value) {
+    int mask = (1 << map->bits) - 1;
+    int slot = pageMapHome(map, pageNum);
+    while (map->slots[slot].value >= 0)
+        slot = (slot + 1) & mask;
+    map->slots[slot].pageNum = pageNum;
+    map->slots[slot].value = value;
+}
+
+// Take a page out of the map. Later entries of the probe run move back into the hole,
+// so no search ever stops short of its page.
+static void pageMapRemove(BM_PageMap *map, const PageNumber pageNum) {
+    int mask = (1 << map->bits) - 1;
+    int hole = pageMapSlot(map, pageNum);
+    if (hole < 0)
+        return;
+
+    for (int slot = (hole + 1) & mask; map->slots[slot].value >= 0; slot = (slot + 1) & mask) {
+        int home = pageMapHome(map, map->slots[slot].pageNum);
+        // An entry stays where it is if its home slot lies cyclically in (hole, slot]
+        bool stays = (hole < slot) ? (home > hole && home <= slot) : (home > hole || home <= slot);
+        if (!stays) {
+            map->slots[hole] = map->slots[slot];
+            hole = slot;
+        }
+    }
+    map->slots[hole].value = -1;
+}
+
+// Frame holding a page, -1 if the page is not in the pool
+static int findFrame(BufferPoolMgmtData *mgmtData, const PageNumber pageNum) {
+    return pageMapGet(&mgmtData->pageTable, pageNum);
+}
+
+// Take a node out of a list linked through the prev and next arrays
+static void listRemove(BM_List *list, int *prev, int *next, int node) {
+    if (prev[node] >= 0)
+        next[prev[node]] = next[node];
+    else
+        list->head = next[node];
+    if (next[node] >= 0)
+        prev[next[node]] = prev[node];
+    else
+        list->tail = prev[node];
+    prev[node] = next[node] = -1;
+    list->size--;
+}
+
+// Put a node at the end of a list linked through the prev and next arrays
+static void listAppend(BM_List *list, int *prev, int *next, int node) {
+    prev[node] = list->tail;
+    next[node] = -1;
+    if (list->tail >= 0)
+        next[list->tail] = node;
+    else
+        list->head = node;
+    list->tail = node;
+    list->size++;
+}
+
+// Take a frame out of the recency list
+static void lruRemove(BufferPoolMgmtData *mgmtData, int frame) {
+    listRemove(&mgmtData->lruList, mgmtData->lruPrev, mgmtData->lruNext, frame);
+}
+
+// Put a frame at the most recently used end of the recency list
+static void lruAppend(BufferPoolMgmtData *mgmtData, int frame) {
+    listAppend(&mgmtData->lruList, mgmtData->lruPrev, mgmtData->lruNext, frame);
+}
+
+// Start a frequency bucket between two neighbouring buckets, prev or next is -1 at either end
+static int lfuNewBucket(BufferPoolMgmtData *mgmtData, int count, int prev, int next) {
+    int bucket = mgmtData->lfuFreeBucket;
+    mgmtData->lfuFreeBucket = mgmtData->lfuBuckets[bucket].next;
+
+    mgmtData->lfuBuckets[bucket].count = count;
+    mgmtData->lfuBuckets[bucket].head = mgmtData->lfuBuckets[bucket].tail = -1;
+    mgmtData->lfuBuckets[bucket].prev = prev;
+    mgmtData->lfuBuckets[bucket].next = next;
+    if (prev >= 0)
+        mgmtData->lfuBuckets[prev].next = bucket;
+    else
+        mgmtData->lfuLowest = bucket;
+    if (next >= 0)
+        mgmtData->lfuBuckets[next].prev = bucket;
+    return bucket;
+}
+
+// Give back a frequency bucket that holds no frame any more
+static void lfuFreeBucket(BufferPoolMgmtData *mgmtData, int bucket) {
+    int prev = mgmtData->lfuBuckets[bucket].prev, next = mgmtData->lfuBuckets[bucket].next;
+    if (prev >= 0)
+        mgmtData->lfuBuckets[prev].next = next;
+    else
+        mgmtData->lfuLowest = next;
+    if (next >= 0)
+        mgmtData->lfuBuckets[next].prev = prev;
+
+    mgmtData->lfuBuckets[bucket].next = mgmtData->lfuFreeBucket;
+    mgmtData->lfuFreeBucket = bucket;
+}
+
+// Put a frame last in a frequency bucket, frames with the same count leave oldest first
+static void lfuAppend(BufferPoolMgmtData *mgmtData, int frame, int bucket) {
+    BM_FreqBucket *b = &mgmtData->lfuBuckets[bucket];
+    mgmtData->lfuBucketOf[frame] = bucket;
+    mgmtData->lfuPrev[frame] = b->tail;
+    mgmtData->lfuNext[frame] = -1;
+    if (b->tail >= 0)
+        mgmtData->lfuNext[b->tail] = frame;
+    else
+        b->head = frame;
+    b->tail = frame;
+}
+
+// Take a frame out of its frequency bucket, the bucket goes away once it is empty
+static void lfuRemove(BufferPoolMgmtData *mgmtData, int frame) {
+    int bucket = mgmtData->lfuBucketOf[frame];
+    BM_FreqBucket *b = &mgmtData->lfuBuckets[bucket];
+    int prev = mgmtData->lfuPrev[frame], next = mgmtData->lfuNext[frame];
+    if (prev >= 0)
+        mgmtData->lfuNext[prev] = next;
+    else
+        b->head = next;
+    if (next >= 0)
+        mgmtData->lfuPrev[next] = prev;
+    else
+        b->tail = prev;
+    mgmtData->lfuBucketOf[frame] = -1;
+    if (b->head < 0)
+        lfuFreeBucket(mgmtData, bucket);
+}
+
+// Age the use counts: every count is halved, but stays at least 1. Halving keeps the order of
+// the buckets, so neighbours that end up with the same count are merged and nothing is sorted.
+static void lfuDecay(BufferPoolMgmtData *mgmtData) {
+    int kept = -1;
+    int bucket = mgmtData->lfuLowest;
+    while (bucket >= 0) {
+        int next = mgmtData->lfuBuckets[bucket].next;
+        int count = mgmtData->lfuBuckets[bucket].count / 2;
+        if (count < 1)
+            count = 1;
+
+        if (kept >= 0 && mgmtData->lfuBuckets[kept].count == count) {
+            // The frames join the bucket before, behind the frames already there
+            BM_FreqBucket *b = &mgmtData->lfuBuckets[bucket];
+            for (int frame = b->head; frame >= 0; frame = mgmtData->lfuNext[frame])
+                mgmtData->lfuBucketOf[frame] = kept;
+            mgmtData->lfuPrev[b->head] = mgmtData->lfuBuckets[kept].tail;
+            mgmtData->lfuNext[mgmtData->lfuBuckets[kept].tail] = b->head;
+            mgmtData->lfuBuckets[kept].tail = b->tail;
+            lfuFreeBucket(mgmtData, bucket);
+        } else {
+            mgmtData->lfuBuckets[bucket].count = count;
+            kept = bucket;
+        }
+        bucket = next;
+    }
+}
+
+// Count a pin towards the next aging of the use counts
+static void lfuTick(BufferPoolMgmtData *mgmtData) {
+    if (mgmtData->lfuDecayPeriod > 0 && ++mgmtData->lfuPinsSinceDecay >= mgmtData->lfuDecayPeriod) {
+        lfuDecay(mgmtData);
+        mgmtData->lfuPinsSinceDecay = 0;
+    }
+}
+
+// Pin times of a page history, the most recent first, 0 where the page was pinned fewer than K times
+static long *lrukTimes(BufferPoolMgmtData *mgmtData, int history) {
+    return mgmtData->lrukTimes + (size_t) history * mgmtData->lrukK;
+}
+
+// Remember another pin of a page
+static void lrukRecordPin(BufferPoolMgmtData *mgmtData, int history) {
+    long *times = lrukTimes(mgmtData, history);
+    memmove(times + 1, times, (mgmtData->lrukK - 1) * sizeof(long));
+    times[0] = ++mgmtData->lrukClock;
+}
+
+// Whether the page in frame a goes before the page in frame b: its K-th last pin is further back,
+// pages pinned fewer than K times go first. Among those the least recently pinned page goes first.
+static bool lrukBefore(BufferPoolMgmtData *mgmtData, int a, int b) {
+    long *timesA = lrukTimes(mgmtData, mgmtData->lrukHistoryOf[a]);
+    long *timesB = lrukTimes(mgmtData, mgmtData->lrukHistoryOf[b]);
+    int k = mgmtData->lrukK - 1;
+    if (timesA[k] != timesB[k])
+        return timesA[k] < timesB[k];
+    return timesA[0] < timesB[0];
+}
+
+// Put a frame at a position of the heap
+static void lrukHeapSet(BufferPoolMgmtData *mgmtData, int pos, int frame) {
+    mgmtData->lrukHeap[pos] = frame;
+    mgmtData->lrukHeapPos[frame] = pos;
+}
+
+// Move a frame up the heap while it goes before its parent
+static void lrukSiftUp(BufferPoolMgmtData *mgmtData, int pos) {
+    int frame = mgmtData->lrukHeap[pos];
+    while (pos > 0 && lrukBefore(mgmtData, frame, mgmtData->lrukHeap[(pos - 1) / 2])) {
+        lrukHeapSet(mgmtData, pos, mgmtData->lrukHeap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    lrukHeapSet(mgmtData, pos, frame);
+}
+
+// Move a frame down the heap while one of its children goes before it
+static void lrukSiftDown(BufferPoolMgmtData *mgmtData, int pos) {
+    int frame = mgmtData->lrukHeap[pos];
+    while (true) {
+        int child = 2 * pos + 1;
+        if (child >= mgmtData->lrukHeapSize)
+            break;
+        if (child + 1 < mgmtData->lrukHeapSize && lrukBefore(mgmtData, mgmtData->lrukHeap[child + 1], mgmtData->lrukHeap[child]))
+            child++;
+        if (!lrukBefore(mgmtData, mgmtData->lrukHeap[child], frame))
+            break;
+        lrukHeapSet(mgmtData, pos, mgmtData->lrukHeap[child]);
+        pos = child;
+    }
+    lrukHeapSet(mgmtData, pos, frame);
+}
+
+static void lrukHeapInsert(BufferPoolMgmtData *mgmtData, int frame) {
+    lrukHeapSet(mgmtData, mgmtData->lrukHeapSize++, frame);
+    lrukSiftUp(mgmtData, mgmtData->lrukHeapSize - 1);
+}
+
+static void lrukHeapRemove(BufferPoolMgmtData *mgmtData, int frame) {
+    int pos = mgmtData->lrukHeapPos[frame];
+    int last = mgmtData->lrukHeap[--mgmtData->lrukHeapSize];
+    if (last == frame)
+        return;
+    lrukHeapSet(mgmtData, pos, last);
+    lrukSiftUp(mgmtData, pos);
+    lrukSiftDown(mgmtData, mgmtData->lrukHeapPos[last]);
+}
+
+// Take a history out of the list of pages that left the pool
+static void lrukUnretain(BufferPoolMgmtData *mgmtData, int history) {
+    BM_PageHistory *h = &mgmtData->lrukHistory[history];
+    if (h->prev >= 0)
+        mgmtData->lrukHistory[h->prev].next = h->next;
+    else
+        mgmtData->lrukRetainedHead = h->next;
+    if (h->next >= 0)
+        mgmtData->lrukHistory[h->next].prev = h->prev;
+    else
+        mgmtData->lrukRetainedTail = h->prev;
+    mgmtData->lrukNumRetained--;
+}
+
+// Forget the history of the page that left the pool the longest time ago
+static void lrukForgetOldest(BufferPoolMgmtData *mgmtData) {
+    int history = mgmtData->lrukRetainedHead;
+    lrukUnretain(mgmtData, history);
+    pageMapRemove(&mgmtData->lrukPages, mgmtData->lrukHistory[history].pageNum);
+    mgmtData->lrukHistory[history].next = mgmtData->lrukFreeHistory;
+    mgmtData->lrukFreeHistory = history;
+}
+
+// The page of a frame left the pool. Its history is kept for as many pages as the pool has frames,
+// a page read again soon after does not start over as if it was never pinned.
+static void lrukRetain(BufferPoolMgmtData *mgmtData, int frame) {
+    int history = mgmtData->lrukHistoryOf[frame];
+    BM_PageHistory *h = &mgmtData->lrukHistory[history];
+    h->prev = mgmtData->lrukRetainedTail;
+    h->next = -1;
+    if (mgmtData->lrukRetainedTail >= 0)
+        mgmtData->lrukHistory[mgmtData->lrukRetainedTail].next = history;
+    else
+        mgmtData->lrukRetainedHead = history;
+    mgmtData->lrukRetainedTail = history;
+    mgmtData->lrukHistoryOf[frame] = -1;
+    if (++mgmtData->lrukNumRetained > mgmtData->lrukMaxRetained)
+        lrukForgetOldest(mgmtData);
+}
+
+// History of a page just loaded into a frame, the retained one if the page was in the pool before
+static int lrukAttach(BufferPoolMgmtData *mgmtData, int frame, const PageNumber pageNum) {
+    int history = pageMapGet(&mgmtData->lrukPages, pageNum);
+    if (history >= 0) {
+        lrukUnretain(mgmtData, history);
+    } else {
+        if (mgmtData->lrukFreeHistory < 0)
+            lrukForgetOldest(mgmtData);
+        history = mgmtData->lrukFreeHistory;
+        mgmtData->lrukFreeHistory = mgmtData->lrukHistory[history].next;
+        mgmtData->lrukHistory[history].pageNum = pageNum;
+        memset(lrukTimes(mgmtData, history), 0, mgmtData->lrukK * sizeof(long));
+        pageMapPut(&mgmtData->lrukPages, pageNum, history);
+    }
+    mgmtData->lrukHistoryOf[frame] = history;
+    return history;
+}
+
+// ARC: resident list of a frame, T1 for pages pinned once since they came in, T2 for pages pinned again
+static BM_List *arcListOf(BufferPoolMgmtData *mgmtData, int frame) {
+    return mgmtData->arcInT2[frame] ? &mgmtData->arcT2 : &mgmtData->arcT1;
+}
+
+// Forget a page that left the pool
+static void arcForget(BufferPoolMgmtData *mgmtData, int ghost) {
+    BM_List *ghosts = mgmtData->arcGhostInB2[ghost] ? &mgmtData->arcB2 : &mgmtData->arcB1;
+    listRemove(ghosts, mgmtData->arcGhostPrev, mgmtData->arcGhostNext, ghost);
+    pageMapRemove(&mgmtData->arcGhosts, mgmtData->arcGhostPage[ghost]);
+    mgmtData->arcGhostNext[ghost] = mgmtData->arcFreeGhost;
+    mgmtData->arcFreeGhost = ghost;
+}
+
+// The page of a frame leaves the pool, its number is remembered in B1 if it came from T1, in B2 if it came from T2
+static void arcRemember(BufferPoolMgmtData *mgmtData, int frame) {
+    if (mgmtData->arcFreeGhost < 0)
+        arcForget(mgmtData, (mgmtData->arcB1.size > 0) ? mgmtData->arcB1.head : mgmtData->arcB2.head);
+
+    int ghost = mgmtData->arcFreeGhost;
+    mgmtData->arcFreeGhost = mgmtData->arcGhostNext[ghost];
+    mgmtData->arcGhostPage[ghost] = mgmtData->pageFrames[frame].pageNum;
+    mgmtData->arcGhostInB2[ghost] = mgmtData->arcInT2[frame];
+    listAppend(mgmtData->arcInT2[frame] ? &mgmtData->arcB2 : &mgmtData->arcB1, mgmtData->arcGhostPrev, mgmtData->arcGhostNext, ghost);
+    pageMapPut(&mgmtData->arcGhosts, mgmtData->pageFrames[frame].pageNum, ghost);
+}
+
+// Least recently pinned frame of a resident list nobody is using, -1 if there is none
+static int arcOldestUnpinned(BufferPoolMgmtData *mgmtData, BM_List *list) {
+    for (int frame = list->head; frame >= 0; frame = mgmtData->arcNext[frame]) {
+        if (mgmtData->pageFrames[frame].fixCount == 0)
+            return frame;
+    }
+    return -1;
+}
+
+// A frame got a new page, the replacement strategy starts keeping track of it
+static void frameLoaded(BM_BufferPool *const bm, int frame) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    switch (bm->strategy) {
+    case RS_LRU:
+        lruAppend(mgmtData, frame);
+        break;
+    case RS_CLOCK:
+        mgmtData->refBits[frame] = true;
+        break;
+    case RS_LFU: {
+        // A new page has been used once
+        int bucket = mgmtData->lfuLowest;
+        if (bucket < 0 || mgmtData->lfuBuckets[bucket].count != 1)
+            bucket = lfuNewBucket(mgmtData, 1, -1, bucket);
+        lfuAppend(mgmtData, frame, bucket);
+        lfuTick(mgmtData);
+        break;
+    }
+    case RS_LRU_K:
+        lrukRecordPin(mgmtData, lrukAttach(mgmtData, frame, mgmtData->pageFrames[frame].pageNum));
+        lrukHeapInsert(mgmtData, frame);
+        break;
+    case RS_ARC:
+        // A page that left the pool not long ago has been pinned twice and joins T2
+        mgmtData->arcInT2[frame] = mgmtData->arcGhostHit;
+        listAppend(arcListOf(mgmtData, frame), mgmtData->arcPrev, mgmtData->arcNext, frame);
+        break;
+    default:
+        break;
+    }
+}
+
+// A page already in a frame was pinned again, the replacement strategy takes note
+static void frameUsed(BM_BufferPool *const bm, int frame) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    switch (bm->strategy) {
+    case RS_LRU:
+        lruRemove(mgmtData, frame);
+        lruAppend(mgmtData, frame);
+        break;
+    case RS_CLOCK:
+        mgmtData->refBits[frame] = true;
+        break;
+    case RS_LFU: {
+        // The frame moves up to the bucket of the next count, made if it is not there yet
+        int bucket = mgmtData->lfuBucketOf[frame];
+        int next = mgmtData->lfuBuckets[bucket].next;
+        int count = mgmtData->lfuBuckets[bucket].count + 1;
+        if (next < 0 || mgmtData->lfuBuckets[next].count != count)
+            next = lfuNewBucket(mgmtData, count, bucket, next);
+        lfuRemove(mgmtData, frame);
+        lfuAppend(mgmtData, frame, next);
+        lfuTick(mgmtData);
+        break;
+    }
+    case RS_LRU_K:
+        // The pin only moves the page further back in the order of replacement
+        lrukRecordPin(mgmtData, mgmtData->lrukHistoryOf[frame]);
+        lrukSiftDown(mgmtData, mgmtData->lrukHeapPos[frame]);
+        break;
+    case RS_ARC:
+        listRemove(arcListOf(mgmtData, frame), mgmtData->arcPrev, mgmtData->arcNext, frame);
+        mgmtData->arcInT2[frame] = true;
+        listAppend(&mgmtData->arcT2, mgmtData->arcPrev, mgmtData->arcNext, frame);
+        break;
+    default:
+        break;
+    }
+}
+
+// A frame lost its page, the replacement strategy forgets it
+static void frameEmptied(BM_BufferPool *const bm, int frame) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    switch (bm->strategy) {
+    case RS_LRU:
+        lruRemove(mgmtData, frame);
+        break;
+    case RS_CLOCK:
+        mgmtData->refBits[frame] = false;
+        break;
+    case RS_LFU:
+        lfuRemove(mgmtData, frame);
+        break;
+    case RS_LRU_K:
+        lrukHeapRemove(mgmtData, frame);
+        lrukRetain(mgmtData, frame);
+        break;
+    case RS_ARC:
+        listRemove(arcListOf(mgmtData, frame), mgmtData->arcPrev, mgmtData->arcNext, frame);
+        arcRemember(mgmtData, frame);
+        break;
+    default:
+        break;
+    }
+}
+
+// Pin a page that is already in a frame
+static RC pinFrame(BM_BufferPool *const bm, BM_PageHandle *const page, int frame) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    mgmtData->pageFrames[frame].fixCount++;
+    frameUsed(bm, frame);
+    page->pageNum = mgmtData->pageFrames[frame].pageNum; // Update page handle
+    page->data = mgmtData->pageFrames[frame].data; // Point to data
+    return RC_OK;
+}
+
+// Empty an unpinned frame, writing its page back first if it was modified
+static RC evictFrame(BM_BufferPool *const bm, int frame) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    if (mgmtData->pageFrames[frame].dirtyFlag) {
+        RC rc = forcePage(bm, &mgmtData->pageFrames[frame]);
+        if (rc != RC_OK)
+            return rc;
+    }
+    pageMapRemove(&mgmtData->pageTable, mgmtData->pageFrames[frame].pageNum);
+    frameEmptied(bm, frame);
+    mgmtData->pageFrames[frame].pageNum = NO_PAGE;
+    mgmtData->pageFrames[frame].dirtyFlag = false;
+    return RC_OK;
+}
+
+// Read a page into a frame holding no page and pin it. If the read fails the frame goes back to the free frames.
+static RC loadFrame(BM_BufferPool *const bm, BM_PageHandle *const page, int frame, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
+    // Loading page from disk
+    RC rc = readPoolPage(bm, &mgmtData->pageFrames[frame], pageNum);
+    if (rc != RC_OK) {
+        mgmtData->freeFrames[mgmtData->numFreeFrames++] = frame;
+        return rc;
+    }
+
+    // Pin the new page in this frame and enter it in the page directory
+    mgmtData->pageFrames[frame].pageNum = pageNum;
+    mgmtData->pageFrames[frame].fixCount = 1;
+    mgmtData->pageFrames[frame].dirtyFlag = false;
+    pageMapPut(&mgmtData->pageTable, pageNum, frame);
+    frameLoaded(bm, frame);
+
+    // Set the `page` handle to this frame
+    page->pageNum = pageNum;
+    page->data = mgmtData->pageFrames[frame].data;
+
+    mgmtData->numReadIO++; // Increment read IO count
+    return RC_OK;
+}
 
 
 // Initialize the buffer pool
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData) {
-   
+    return initBufferPoolMode(bm, pageFileName, numPages, strategy, stratData, SM_MODE_PREAD);
+}
+
+// Initialize the buffer pool choosing how its page file is accessed.
+// With SM_MODE_DIRECT the OS page cache is bypassed and the pool is the only copy of a page in memory.
+RC initBufferPoolMode(BM_BufferPool *const bm, const char *const pageFileName, const int numPages, ReplacementStrategy strategy, void *stratData, SM_OpenMode ioMode) {
+    if (numPages <= 0)
+        return RC_WRITE_FAILED;
+
     // Allocate memory for the page file name and copy it
     bm->pageFile = (char *) malloc(strlen(pageFileName) + 1);
     strcpy(bm->pageFile, pageFileName);
@@ -29,19 +589,107 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const
         mgmtData->pageFrames[i].pageNum = NO_PAGE; // Initialize all frames as empty
         mgmtData->pageFrames[i].dirtyFlag = false; // Pages are clean initially
         mgmtData->pageFrames[i].fixCount = 0; // No pages are pinned initially
-        mgmtData->pageFrames[i].data = malloc(PAGE_SIZE);
+        mgmtData->pageFrames[i].data = NULL; // Frames get their memory when the page file is opened
+    }
+    mgmtData->frameMemory = NULL;
+    mgmtData->pageSize = 0;
+
+    // Page directory finding the frame of a page
+    pageMapInit(&mgmtData->pageTable, numPages);
+
+    // All frames are free, the lowest frame is handed out first
+    mgmtData->freeFrames = malloc(numPages * sizeof(int));
+    for (int i = 0; i < numPages; i++)
+        mgmtData->freeFrames[i] = numPages - 1 - i;
+    mgmtData->numFreeFrames = numPages;
+
+    mgmtData->lruPrev = malloc(numPages * sizeof(int));
+    mgmtData->lruNext = malloc(numPages * sizeof(int));
+    memset(mgmtData->lruPrev, -1, numPages * sizeof(int));
+    memset(mgmtData->lruNext, -1, numPages * sizeof(int));
+    mgmtData->lruList = (BM_List) { -1, -1, 0 };
+
+    mgmtData->refBits = calloc(numPages, sizeof(bool));
+    mgmtData->clockHand = 0;
+
+    // LFU: one bucket per use count in the pool, and one more while a frame moves up.
+    // stratData optionally points to the number of pins after which all use counts are halved.
+    mgmtData->lfuBuckets = NULL;
+    mgmtData->lfuBucketOf = mgmtData->lfuPrev = mgmtData->lfuNext = NULL;
+    mgmtData->lfuLowest = mgmtData->lfuFreeBucket = -1;
+    mgmtData->lfuDecayPeriod = 0;
+    mgmtData->lfuPinsSinceDecay = 0;
+    if (strategy == RS_LFU) {
+        mgmtData->lfuBuckets = malloc((numPages + 1) * sizeof(BM_FreqBucket));
+        for (int i = 0; i <= numPages; i++)
+            mgmtData->lfuBuckets[i].next = (i < numPages) ? i + 1 : -1;
+        mgmtData->lfuFreeBucket = 0;
+        mgmtData->lfuBucketOf = malloc(numPages * sizeof(int));
+        mgmtData->lfuPrev = malloc(numPages * sizeof(int));
+        mgmtData->lfuNext = malloc(numPages * sizeof(int));
+        if (stratData != NULL)
+            mgmtData->lfuDecayPeriod = *(int *) stratData;
     }
 
-    mgmtData->LRU = malloc(numPages * sizeof(PageNumber));
-    if (mgmtData->LRU == NULL) fprintf(stderr, "Memory allocation for LRU failed\n");
-    
-    
+    // LRU-K: stratData optionally points to K, 2 by default. Histories are kept for the pages in
+    // the pool and for as many pages again that left it.
+    mgmtData->lrukK = 2;
+    mgmtData->lrukClock = 0;
+    mgmtData->lrukHistory = NULL;
+    mgmtData->lrukTimes = NULL;
+    mgmtData->lrukPages.slots = NULL;
+    mgmtData->lrukFreeHistory = mgmtData->lrukRetainedHead = mgmtData->lrukRetainedTail = -1;
+    mgmtData->lrukNumRetained = 0;
+    mgmtData->lrukMaxRetained = numPages;
+    mgmtData->lrukHistoryOf = mgmtData->lrukHeap = mgmtData->lrukHeapPos = mgmtData->lrukSkipped = NULL;
+    mgmtData->lrukHeapSize = 0;
+    if (strategy == RS_LRU_K) {
+        if (stratData != NULL && *(int *) stratData > 0)
+            mgmtData->lrukK = *(int *) stratData;
+        mgmtData->lrukHistory = malloc(2 * numPages * sizeof(BM_PageHistory));
+        for (int i = 0; i < 2 * numPages; i++)
+            mgmtData->lrukHistory[i].next = (i + 1 < 2 * numPages) ? i + 1 : -1;
+        mgmtData->lrukFreeHistory = 0;
+        mgmtData->lrukTimes = malloc((size_t) 2 * numPages * mgmtData->lrukK * sizeof(long));
+        pageMapInit(&mgmtData->lrukPages, 2 * numPages);
+        mgmtData->lrukHistoryOf = malloc(numPages * sizeof(int));
+        mgmtData->lrukHeap = malloc(numPages * sizeof(int));
+        mgmtData->lrukHeapPos = malloc(numPages * sizeof(int));
+        mgmtData->lrukSkipped = malloc(numPages * sizeof(int));
+    }
 
+    // ARC: as many ghosts as frames, ghosts are page numbers of pages that left the pool
+    mgmtData->arcT1 = mgmtData->arcT2 = mgmtData->arcB1 = mgmtData->arcB2 = (BM_List) { -1, -1, 0 };
+    mgmtData->arcP = 0;
+    mgmtData->arcPrev = mgmtData->arcNext = NULL;
+    mgmtData->arcInT2 = NULL;
+    mgmtData->arcGhostPage = NULL;
+    mgmtData->arcGhostPrev = mgmtData->arcGhostNext = NULL;
+    mgmtData->arcGhostInB2 = NULL;
+    mgmtData->arcGhosts.slots = NULL;
+    mgmtData->arcFreeGhost = -1;
+    mgmtData->arcGhostHit = false;
+    if (strategy == RS_ARC) {
+        mgmtData->arcPrev = malloc(numPages * sizeof(int));
+        mgmtData->arcNext = malloc(numPages * sizeof(int));
+        mgmtData->arcInT2 = calloc(numPages, sizeof(bool));
+        mgmtData->arcGhostPage = malloc(numPages * sizeof(PageNumber));
+        mgmtData->arcGhostPrev = malloc(numPages * sizeof(int));
+        mgmtData->arcGhostNext = malloc(numPages * sizeof(int));
+        mgmtData->arcGhostInB2 = calloc(numPages, sizeof(bool));
+        for (int i = 0; i < numPages; i++)
+            mgmtData->arcGhostNext[i] = (i + 1 < numPages) ? i + 1 : -1;
+        mgmtData->arcFreeGhost = 0;
+        pageMapInit(&mgmtData->arcGhosts, numPages);
+    }
 
     // Initialize statistics for read/write IO
     mgmtData->numReadIO = 0;
     mgmtData->numWriteIO = 0;
     mgmtData->next = 0;
+    mgmtData->fileHandle.mgmtInfo = NULL;
+    mgmtData->ioMode = ioMode;
+    mgmtData->activeScans = 0;
 
     return RC_OK;
 }
@@ -59,19 +707,44 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
     printPoolContent(bm);
 
     // Free memory for page frames
-    for (int i = 0; i < bm->numPages; i++)
-        free(mgmtData->pageFrames[i].data); // Free individual page data
+    free(mgmtData->frameMemory); // Free the page data of all frames
+
+    // Release the page file
+    if (mgmtData->fileHandle.mgmtInfo != NULL)
+        closePageFile(&mgmtData->fileHandle);
 
     printf("Freeing page frames\n");
     free(mgmtData->pageFrames); // Free page frames
+    free(mgmtData->pageTable.slots);
+    free(mgmtData->freeFrames);
+    free(mgmtData->lruPrev);
+    free(mgmtData->lruNext);
+    free(mgmtData->refBits);
+    free(mgmtData->lfuBuckets);
+    free(mgmtData->lfuBucketOf);
+    free(mgmtData->lfuPrev);
+    free(mgmtData->lfuNext);
+    free(mgmtData->lrukHistory);
+    free(mgmtData->lrukTimes);
+    free(mgmtData->lrukPages.slots);
+    free(mgmtData->lrukHistoryOf);
+    free(mgmtData->lrukHeap);
+    free(mgmtData->lrukHeapPos);
+    free(mgmtData->lrukSkipped);
+    free(mgmtData->arcPrev);
+    free(mgmtData->arcNext);
+    free(mgmtData->arcInT2);
+    free(mgmtData->arcGhostPage);
+    free(mgmtData->arcGhostPrev);
+    free(mgmtData->arcGhostNext);
+    free(mgmtData->arcGhostInB2);
+    free(mgmtData->arcGhosts.slots);
 
     printf("Freeing management data\n");
 
     printf("Freeing page file\n");
     free(bm->pageFile); // Free the page file string
 
-    printPoolContent(bm);
-
     free(bm->mgmtData); // Free management data
     printf("Buffer pool shutdown completed\n");
     
@@ -82,11 +755,33 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
 RC forceFlushPool(BM_BufferPool *const bm) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
-    // Loop through all page frames and flush dirty pages
-    for (int i = 0; i < bm->numPages; i++)
-        if (mgmtData->pageFrames[i].fixCount == 0 && mgmtData->pageFrames[i].dirtyFlag) 
-            forcePage(bm, &mgmtData->pageFrames[i]); // Write the page back to disk
-    
+    // Collect all dirty pages nobody is using
+    SM_BlockRef *blocks = malloc(bm->numPages * sizeof(SM_BlockRef));
+    int numBlocks = 0;
+    for (int i = 0; i < bm->numPages; i++) {
+        if (mgmtData->pageFrames[i].fixCount == 0 && mgmtData->pageFrames[i].dirtyFlag) {
+            blocks[numBlocks].pageNum = mgmtData->pageFrames[i].pageNum;
+            blocks[numBlocks].memPage = mgmtData->pageFrames[i].data;
+            numBlocks++;
+        }
+    }
+
+    // Write them back together, neighbouring pages go to disk in a single call
+    RC rc = RC_OK;
+    if (numBlocks > 0) {
+        SM_FileHandle *fh = getPoolFile(bm);
+        rc = (fh == NULL) ? RC_FILE_NOT_FOUND : writeBlocks(blocks, numBlocks, fh);
+    }
+    free(blocks);
+    if (rc != RC_OK)
+        return rc;
+
+    for (int i = 0; i < bm->numPages; i++) {
+        if (mgmtData->pageFrames[i].fixCount == 0 && mgmtData->pageFrames[i].dirtyFlag) {
+            mgmtData->pageFrames[i].dirtyFlag = false;
+            mgmtData->numWriteIO++;
+        }
+    }
     return RC_OK;
 }
 
@@ -94,37 +789,29 @@ RC forceFlushPool(BM_BufferPool *const bm) {
 // Mark a page as dirty
 RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
-    // First, let's loop through the buffer...
-    for (int i = 0; i < bm->numPages; i++) {
-        // and if we found the desired page
-        if (mgmtData->pageFrames[i].pageNum == page->pageNum) {
-            // Mark it as DIRTY
-            mgmtData->pageFrames[i].dirtyFlag = true;
-            return RC_OK;
-        }
-    }
+    // Look the page up in the page directory
+    int frame = findFrame(mgmtData, page->pageNum);
     // Error if page isn't found
-    return RC_READ_NON_EXISTING_PAGE;
+    if (frame < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    // Mark it as DIRTY
+    mgmtData->pageFrames[frame].dirtyFlag = true;
+    return RC_OK;
 }
 
 // Unpin a page from the buffer pool
 RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
-    // Loop for the page we want to unpin
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == page->pageNum) {
-            // If pinned...
-            if (mgmtData->pageFrames[i].fixCount > 0) {
-                // Decrease fixCount
-                mgmtData->pageFrames[i].fixCount--;
-                return RC_OK;
-            }
-        }
-    }
-
     // Error if page not found / already unpinned
-    return RC_READ_NON_EXISTING_PAGE;
+    int frame = findFrame(mgmtData, page->pageNum);
+    if (frame < 0 || mgmtData->pageFrames[frame].fixCount == 0)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    // Decrease fixCount
+    mgmtData->pageFrames[frame].fixCount--;
+    return RC_OK;
 }
 
 
@@ -132,20 +819,21 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
 RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
-    // Loop again for the page we are looking for...
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == page->pageNum) {
-            // If dirty flag is true...
-            if (mgmtData->pageFrames[i].dirtyFlag) {
-                // Writing the page back to disk
-                mgmtData->numWriteIO++; // Incrementing write IO count...
-                mgmtData->pageFrames[i].dirtyFlag = false; // and setting dirty flag to false
-                return RC_OK;
-            }
-        }
-    }
-    // Error in case page not found
-    return RC_READ_NON_EXISTING_PAGE; // If page is not found
+    // Error in case page not found or nothing to write
+    int frame = findFrame(mgmtData, page->pageNum);
+    if (frame < 0 || !mgmtData->pageFrames[frame].dirtyFlag)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    // Writing the page back to disk
+    SM_FileHandle *fh = getPoolFile(bm);
+    if (fh == NULL)
+        return RC_FILE_NOT_FOUND;
+    RC rc = writeBlock(mgmtData->pageFrames[frame].pageNum, fh, mgmtData->pageFrames[frame].data);
+    if (rc != RC_OK)
+        return rc;
+    mgmtData->numWriteIO++; // Incrementing write IO count...
+    mgmtData->pageFrames[frame].dirtyFlag = false; // and setting dirty flag to false
+    return RC_OK;
 }
 
 
@@ -154,16 +842,25 @@ RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
            const PageNumber pageNum) {
     switch(bm->strategy)
 	{
-	case RS_FIFO:
-		pinPageFIFO(bm, page, pageNum);
-		break;
-
 	case RS_LRU:
-		pinPageLRU(bm, page, pageNum);
-    default:
-        break;
+		return pinPageLRU(bm, page, pageNum);
+
+	case RS_CLOCK:
+		return pinPageCLOCK(bm, page, pageNum);
+
+	case RS_LFU:
+		return pinPageLFU(bm, page, pageNum);
+
+	case RS_LRU_K:
+		return pinPageLRUK(bm, page, pageNum);
+
+	case RS_ARC:
+		return pinPageARC(bm, page, pageNum);
+
+	case RS_FIFO:
+	default:
+		return pinPageFIFO(bm, page, pageNum);
 	}
-	return RC_OK;
 }
 
 RC pinPageFIFO(BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumber pageNum)
@@ -171,137 +868,280 @@ RC pinPageFIFO(BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumb
 	BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
     // First things first... check if page is in the buffer...
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == pageNum) {
-            // If it's in the buffer then we increase fix count
-            mgmtData->pageFrames[i].fixCount++;
-            page->pageNum = pageNum; // Update page handle
-            page->data = mgmtData->pageFrames[i].data; // Point to data
-            return RC_OK;
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // If page is not in buffer... then we take an empty frame to load it
+    if (mgmtData->numFreeFrames > 0)
+        return loadFrame(bm, page, mgmtData->freeFrames[--mgmtData->numFreeFrames], pageNum);
+
+    // Otherwise the oldest frame in FIFO order, skipping the pinned ones
+    for (int tries = 0; tries < bm->numPages; tries++) {
+        frame = mgmtData->next;
+        // Move to the next frame in FIFO order
+        mgmtData->next = (mgmtData->next + 1) % bm->numPages;
+        if (mgmtData->pageFrames[frame].fixCount == 0) {
+            RC rc = evictFrame(bm, frame);
+            if (rc != RC_OK)
+                return rc;
+            return loadFrame(bm, page, frame, pageNum);
         }
     }
 
-    // If page is not in buffer... then we find a empty frame to load it
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == NO_PAGE) {
-            // Loading page from disk
-            // Load the page into the empty frame
-            mgmtData->pageFrames[i].pageNum = pageNum;
-            // Fix count becomes 1
-            mgmtData->pageFrames[i].fixCount = 1;
-            // Now... setting the page
-            page->pageNum = pageNum;
-            // As well as data pointer
-            page->data = mgmtData->pageFrames[i].data;
-
-            mgmtData->numReadIO++; // Increment read IO count
-            return RC_OK;
+    // Every frame is pinned
+    return RC_ALL_FRAMES_PINNED;
+}
+
+RC pinPageLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+
+    // First things first... check if page is in the buffer...
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // If page is not in buffer... then we take an empty frame to load it
+    if (mgmtData->numFreeFrames > 0)
+        return loadFrame(bm, page, mgmtData->freeFrames[--mgmtData->numFreeFrames], pageNum);
+
+    // Otherwise the least recently pinned frame nobody is using
+    for (frame = mgmtData->lruList.head; frame >= 0; frame = mgmtData->lruNext[frame]) {
+        if (mgmtData->pageFrames[frame].fixCount == 0) {
+            RC rc = evictFrame(bm, frame);
+            if (rc != RC_OK)
+                return rc;
+            return loadFrame(bm, page, frame, pageNum);
         }
     }
 
-    while (true) {
-        printf("\nIndex %i\n", mgmtData->next);
-        
-        // Check if the page at `next` is pinned
-        if (mgmtData->pageFrames[mgmtData->next].fixCount == 0) {
-            // If the page is dirty, write it to disk
-            if (mgmtData->pageFrames[mgmtData->next].dirtyFlag) {
-                forcePage(bm, &mgmtData->pageFrames[mgmtData->next]);
+    // Every frame is pinned
+    return RC_ALL_FRAMES_PINNED;
+}
+
+RC pinPageCLOCK(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+
+    // First things first... check if page is in the buffer...
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // If page is not in buffer... then we take an empty frame to load it
+    if (mgmtData->numFreeFrames > 0)
+        return loadFrame(bm, page, mgmtData->freeFrames[--mgmtData->numFreeFrames], pageNum);
+
+    // Otherwise the hand sweeps the frames: a frame used since the hand last passed gets a second
+    // chance and loses its reference bit, the first unpinned frame without one is replaced.
+    // Two rounds clear every reference bit, so the sweep ends unless every frame is pinned.
+    for (int tries = 0; tries < 2 * bm->numPages; tries++) {
+        frame = mgmtData->clockHand;
+        mgmtData->clockHand = (mgmtData->clockHand + 1) % bm->numPages;
+        if (mgmtData->pageFrames[frame].fixCount > 0)
+            continue;
+        if (mgmtData->refBits[frame]) {
+            mgmtData->refBits[frame] = false;
+            continue;
+        }
+        RC rc = evictFrame(bm, frame);
+        if (rc != RC_OK)
+            return rc;
+        return loadFrame(bm, page, frame, pageNum);
+    }
+
+    // Every frame is pinned
+    return RC_ALL_FRAMES_PINNED;
+}
+
+RC pinPageLFU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+
+    // First things first... check if page is in the buffer...
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // If page is not in buffer... then we take an empty frame to load it
+    if (mgmtData->numFreeFrames > 0)
+        return loadFrame(bm, page, mgmtData->freeFrames[--mgmtData->numFreeFrames], pageNum);
+
+    // Otherwise the least often pinned frame nobody is using, the longest in its bucket among equals
+    for (int bucket = mgmtData->lfuLowest; bucket >= 0; bucket = mgmtData->lfuBuckets[bucket].next) {
+        for (frame = mgmtData->lfuBuckets[bucket].head; frame >= 0; frame = mgmtData->lfuNext[frame]) {
+            if (mgmtData->pageFrames[frame].fixCount == 0) {
+                RC rc = evictFrame(bm, frame);
+                if (rc != RC_OK)
+                    return rc;
+                return loadFrame(bm, page, frame, pageNum);
             }
+        }
+    }
 
-            // Pin the new page in this frame (set fixCount, update page number, etc.)
-            mgmtData->pageFrames[mgmtData->next].pageNum = pageNum;
-            mgmtData->pageFrames[mgmtData->next].fixCount = 1;
-            mgmtData->pageFrames[mgmtData->next].dirtyFlag = false;
+    // Every frame is pinned
+    return RC_ALL_FRAMES_PINNED;
+}
 
-            // Set the `page` handle to this frame
-            page->pageNum = pageNum;
-            page->data = mgmtData->pageFrames[mgmtData->next].data;
+RC pinPageLRUK(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
-            // Move to the next frame in FIFO order
-            mgmtData->next = (mgmtData->next + 1) % bm->numPages;
+    // First things first... check if page is in the buffer...
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // If page is not in buffer... then we take an empty frame to load it
+    if (mgmtData->numFreeFrames > 0)
+        return loadFrame(bm, page, mgmtData->freeFrames[--mgmtData->numFreeFrames], pageNum);
+
+    // Otherwise the frame on top of the heap, with the largest backward K-distance. Pinned frames
+    // on top are set aside until an unpinned one comes up and then go back.
+    int numSkipped = 0;
+    frame = -1;
+    while (mgmtData->lrukHeapSize > 0) {
+        int top = mgmtData->lrukHeap[0];
+        if (mgmtData->pageFrames[top].fixCount == 0) {
+            frame = top;
             break;
-        } else {
-            // Move to the next frame if current one is pinned
-            mgmtData->next = (mgmtData->next + 1) % bm->numPages;
         }
+        lrukHeapRemove(mgmtData, top);
+        mgmtData->lrukSkipped[numSkipped++] = top;
     }
+    while (numSkipped > 0)
+        lrukHeapInsert(mgmtData, mgmtData->lrukSkipped[--numSkipped]);
 
-    mgmtData->numReadIO++;
-    return RC_OK;
+    // Every frame is pinned
+    if (frame < 0)
+        return RC_ALL_FRAMES_PINNED;
+
+    RC rc = evictFrame(bm, frame);
+    if (rc != RC_OK)
+        return rc;
+    return loadFrame(bm, page, frame, pageNum);
 }
 
-RC pinPageLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+// ARC: empty a frame for a miss with the pool full. T1 gives up its oldest page while it is larger
+// than its target size, T2 otherwise. If every frame of that list is pinned the other one gives a page.
+static RC arcReplace(BM_BufferPool *const bm, bool inB2, int *victim) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    bool fromT1 = mgmtData->arcT1.size > 0
+        && (mgmtData->arcT1.size > mgmtData->arcP || (inB2 && mgmtData->arcT1.size == mgmtData->arcP));
+
+    int frame = arcOldestUnpinned(mgmtData, fromT1 ? &mgmtData->arcT1 : &mgmtData->arcT2);
+    if (frame < 0)
+        frame = arcOldestUnpinned(mgmtData, fromT1 ? &mgmtData->arcT2 : &mgmtData->arcT1);
+    // Every frame is pinned
+    if (frame < 0)
+        return RC_ALL_FRAMES_PINNED;
+
+    *victim = frame;
+    return evictFrame(bm, frame);
+}
+
+RC pinPageARC(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    int c = bm->numPages;
 
     // First things first... check if page is in the buffer...
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == pageNum) {
-            // If it's in the buffer then we increase fix count
-            mgmtData->pageFrames[i].fixCount++;
-            printf("\nPage read index %i \n", i);
-            mgmtData->LRU[mgmtData->next] = i;
-            mgmtData->next++;
-            page->pageNum = pageNum; // Update page handle
-            page->data = mgmtData->pageFrames[i].data; // Point to data
-            return RC_OK;
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame >= 0)
+        return pinFrame(bm, page, frame);
+
+    // A miss on a page that left the pool not long ago moves the target size of T1: up if it
+    // left from T1, T1 was too small for it, down if it left from T2. The smaller ghost list moves it more.
+    int ghost = pageMapGet(&mgmtData->arcGhosts, pageNum);
+    bool inB2 = (ghost >= 0 && mgmtData->arcGhostInB2[ghost]);
+    int b1 = mgmtData->arcB1.size, b2 = mgmtData->arcB2.size;
+    if (ghost >= 0 && !inB2) {
+        mgmtData->arcP += (b1 >= b2) ? 1 : b2 / b1;
+        if (mgmtData->arcP > c)
+            mgmtData->arcP = c;
+    } else if (inB2) {
+        mgmtData->arcP -= (b2 >= b1) ? 1 : b1 / b2;
+        if (mgmtData->arcP < 0)
+            mgmtData->arcP = 0;
+    }
+    // The ghost has served its purpose, it goes before the replaced page needs one
+    if (ghost >= 0) {
+        arcForget(mgmtData, ghost);
+    } else if (mgmtData->arcT1.size + b1 >= c) {
+        // A new page and T1 with its ghosts fills the pool: the oldest ghost of T1 goes, or with
+        // T1 taking every frame its oldest page, without being remembered
+        if (mgmtData->arcT1.size < c) {
+            arcForget(mgmtData, mgmtData->arcB1.head);
+        } else {
+            frame = arcOldestUnpinned(mgmtData, &mgmtData->arcT1);
+            if (frame < 0)
+                return RC_ALL_FRAMES_PINNED;
+            RC rc = evictFrame(bm, frame);
+            if (rc != RC_OK)
+                return rc;
+            arcForget(mgmtData, mgmtData->arcB1.tail);
         }
+    } else if (mgmtData->arcT1.size + mgmtData->arcT2.size + b1 + b2 >= 2 * c && b2 > 0) {
+        // The ghosts of T2 are kept to the size of the pool
+        arcForget(mgmtData, mgmtData->arcB2.head);
     }
 
-    // If page is not in buffer... then we find a empty frame to load it
-    for (int i = 0; i < bm->numPages; i++) {
-        if (mgmtData->pageFrames[i].pageNum == NO_PAGE) {
-            // Loading page from disk
-            // Load the page into the empty frame
-            mgmtData->pageFrames[i].pageNum = pageNum;
-            // Fix count becomes 1
-            mgmtData->pageFrames[i].fixCount = 1;
-            // Now... setting the page
-            page->pageNum = pageNum;
-            // As well as data pointer
-            page->data = mgmtData->pageFrames[i].data;
-
-            mgmtData->numReadIO++; // Increment read IO count
-            return RC_OK;
-        }
+    // If page is not in buffer... then we take an empty frame to load it, or replace a page
+    if (frame < 0 && mgmtData->numFreeFrames > 0)
+        frame = mgmtData->freeFrames[--mgmtData->numFreeFrames];
+    if (frame < 0) {
+        RC rc = arcReplace(bm, inB2, &frame);
+        if (rc != RC_OK)
+            return rc;
     }
+    mgmtData->arcGhostHit = (ghost >= 0);
+    RC rc = loadFrame(bm, page, frame, pageNum);
+    mgmtData->arcGhostHit = false;
+    return rc;
+}
 
-    while (true) {
-        printf("\nIndex %i\n", mgmtData->LRU[0]);
-        
-        if (mgmtData->pageFrames[mgmtData->LRU[0]].dirtyFlag) {
-            forcePage(bm, &mgmtData->pageFrames[mgmtData->LRU[0]]);
-        }
+// A scan reading the page file once starts: the storage manager is told the file is read in order
+// for as long as at least one such scan runs
+RC beginPoolScan(BM_BufferPool *const bm) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    SM_FileHandle *fh = getPoolFile(bm);
+    if (fh == NULL)
+        return RC_FILE_NOT_FOUND;
 
-            // Pin the new page in this frame (set fixCount, update page number, etc.)
-            mgmtData->pageFrames[mgmtData->LRU[0]].pageNum = pageNum;
-            mgmtData->pageFrames[mgmtData->LRU[0]].fixCount = 1;
-            mgmtData->pageFrames[mgmtData->LRU[0]].dirtyFlag = false;
+    if (mgmtData->activeScans++ == 0)
+        setSequentialHint(fh, true);    // Only a hint, backends without page cache ignore it
+    return RC_OK;
+}
 
-            // Set the `page` handle to this frame
-            page->pageNum = pageNum;
-            page->data = mgmtData->pageFrames[mgmtData->LRU[0]].data;
+// A scan started with beginPoolScan is done
+RC endPoolScan(BM_BufferPool *const bm) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
+    SM_FileHandle *fh = getPoolFile(bm);
+    if (fh == NULL || mgmtData->activeScans == 0)
+        return RC_FILE_NOT_FOUND;
 
-            int temp = mgmtData->LRU[0];
-            for (int i = 0; i < bm->numPages - 1; i++) {
-                mgmtData->LRU[i] = mgmtData->LRU[i + 1];
-            }
-            mgmtData->LRU[bm->numPages - 1] = temp;
+    if (--mgmtData->activeScans == 0)
+        setSequentialHint(fh, false);
+    return RC_OK;
+}
 
-            break;
-        }
+// A scan reading the page file once is past a page it read: the page leaves the pool, written
+// back first if it was modified. Its frame is taken first by the next miss instead of a frame
+// holding a page that is used over and over. A page someone pinned stays. The storage manager
+// drops the scanned pages from the OS page cache on its own while the scan runs.
+RC releaseScannedPage(BM_BufferPool *const bm, const PageNumber pageNum) {
+    BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
 
-    mgmtData->numReadIO++;
+    int frame = findFrame(mgmtData, pageNum);
+    if (frame < 0 || mgmtData->pageFrames[frame].fixCount > 0)
+        return RC_OK;
+
+    RC rc = evictFrame(bm, frame);
+    if (rc != RC_OK)
+        return rc;
+    mgmtData->freeFrames[mgmtData->numFreeFrames++] = frame;
     return RC_OK;
 }
 
 // Get the frame contents of the buffer pool
 PageNumber *getFrameContents(BM_BufferPool *const bm) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
-    if (bm->numPages <= 0 || bm->numPages > MAX_ALLOWED_PAGES) {
-        fprintf(stderr, "Error: Invalid number of pages (%d)\n", bm->numPages);
-        return NULL;
-    }
 
     PageNumber *frameContents = (PageNumber *) malloc(bm->numPages * sizeof(PageNumber));
 
@@ -316,11 +1156,6 @@ PageNumber *getFrameContents(BM_BufferPool *const bm) {
 // Get dirty flags for the buffer pool
 bool *getDirtyFlags(BM_BufferPool *const bm) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
-    
-    if (bm->numPages <= 0 || bm->numPages > MAX_ALLOWED_PAGES) {
-        fprintf(stderr, "Error: Invalid number of pages (%d)\n", bm->numPages);
-        return NULL;
-    }
     bool *dirtyFlags = (bool *) malloc(bm->numPages * sizeof(bool));
 
     for (int i = 0; i < bm->numPages; i++){
@@ -337,10 +1172,6 @@ bool *getDirtyFlags(BM_BufferPool *const bm) {
 // Get fix counts for the buffer pool
 int *getFixCounts(BM_BufferPool *const bm) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
-    if (bm->numPages <= 0 || bm->numPages > MAX_ALLOWED_PAGES) {
-        fprintf(stderr, "Error: Invalid number of pages (%d)\n", bm->numPages);
-        return NULL;
-    }
     int *fixCounts = (int *) malloc(bm->numPages * sizeof(int));
 
     for (int i = 0; i < bm->numPages; i++)
@@ -361,4 +1192,12 @@ int getNumReadIO(BM_BufferPool *const bm) {
 int getNumWriteIO(BM_BufferPool *const bm) {
     BufferPoolMgmtData *mgmtData = (BufferPoolMgmtData *) bm->mgmtData;
     return mgmtData->numWriteIO;
-}
\ No newline at end of file
+}
+
+// Get the I/O statistics of the pool's page file, to tell time spent on disk from time spent in the pool
+RC getPoolFileStats(BM_BufferPool *const bm, SM_FileStats *stats) {
+    SM_FileHandle *fh = getPoolFile(bm);
+    if (fh == NULL)
+        return RC_FILE_NOT_FOUND;
+    return getFileStats(fh, stats);
+}
@@ -7,13 +7,17 @@
 // Include bool DT
 #include "dt.h"
 
+// Include the storage manager the pool reads and writes pages through
+#include "storage_mgr.h"
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -35,13 +39,97 @@ typedef struct BM_PageHandle {
 	int fixCount;
 } BM_PageHandle;
 
+// A doubly linked list of frames or other small integers, the links are kept in arrays next to it
+typedef struct BM_List {
+    int head;   // -1 if the list is empty
+    int tail;
+    int size;
+} BM_List;
+
+// Open addressing hash table from page numbers to non-negative values, linear probing
+typedef struct BM_PageMapSlot {
+    PageNumber pageNum;
+    int value;   // -1 for an empty slot
+} BM_PageMapSlot;
+
+typedef struct BM_PageMap {
+    BM_PageMapSlot *slots;
+    int bits;   // The map has 1 << bits slots
+} BM_PageMap;
+
+// LFU: the frames pinned the same number of times, buckets are kept in increasing order of count
+typedef struct BM_FreqBucket {
+    int count;   // Number of pins of the frames in the bucket
+    int head;   // Frame in the bucket the longest, -1 if the bucket is empty
+    int tail;
+    int prev;   // Bucket with the next lower count, -1 for the lowest
+    int next;   // Bucket with the next higher count, next free bucket while unused
+} BM_FreqBucket;
+
+// LRU-K: what is known about the recent pins of a page, its pin times are kept next to it in lrukTimes
+typedef struct BM_PageHistory {
+    PageNumber pageNum;
+    int prev;   // Pages that left the pool in the order they left, a doubly linked list
+    int next;   // Next free history while unused
+} BM_PageHistory;
+
 // Structure to hold buffer pool management data
 typedef struct BufferPoolMgmtData {
     BM_PageHandle *pageFrames;   // Array of page frames to store pages in memory
     int numReadIO;   // Number of Reads fow the statistics
 	int numWriteIO;   // Number of Writes fow the statistics
     int next;   // FIFO utilization
-    int* LRU;
+    BM_PageMap pageTable;   // Page directory: frame index of every page in the pool
+    int *freeFrames;   // Stack of the frames holding no page
+    int numFreeFrames;
+    BM_List lruList;   // LRU: frames holding a page in order of their last pin, least recently pinned first
+    int *lruPrev;
+    int *lruNext;
+    bool *refBits;   // CLOCK: frames pinned since the hand last passed them
+    int clockHand;   // CLOCK: next frame the hand looks at
+    BM_FreqBucket *lfuBuckets;   // LFU: frequency buckets, only allocated for LFU pools
+    int lfuLowest;   // LFU: bucket with the lowest count, -1 if the pool is empty
+    int lfuFreeBucket;   // LFU: first unused bucket
+    int *lfuBucketOf;   // LFU: bucket of every frame holding a page
+    int *lfuPrev;   // LFU: frames of a bucket in the order they entered it, a doubly linked list
+    int *lfuNext;
+    int lfuDecayPeriod;   // LFU: pins between two halvings of all counts, 0 to never age them
+    int lfuPinsSinceDecay;
+    int lrukK;   // LRU-K: number of pins remembered for every page
+    long lrukClock;   // LRU-K: pins so far, the time of a pin
+    BM_PageHistory *lrukHistory;   // LRU-K: histories of the pages in the pool and of pages that left it
+    long *lrukTimes;   // LRU-K: last K pin times of every history
+    BM_PageMap lrukPages;   // LRU-K: history of a page
+    int lrukFreeHistory;   // LRU-K: first unused history
+    int lrukRetainedHead;   // LRU-K: history of the page that left the pool the longest time ago
+    int lrukRetainedTail;
+    int lrukNumRetained;   // LRU-K: histories of pages that left the pool
+    int lrukMaxRetained;
+    int *lrukHistoryOf;   // LRU-K: history of the page in every frame
+    int *lrukHeap;   // LRU-K: frames holding a page, the next one to replace on top
+    int *lrukHeapPos;   // LRU-K: position of every frame in the heap
+    int lrukHeapSize;
+    int *lrukSkipped;   // LRU-K: pinned frames set aside while looking for the one to replace
+    BM_List arcT1;   // ARC: frames of pages pinned once since they came in, least recently pinned first
+    BM_List arcT2;   // ARC: frames of pages pinned more than once
+    BM_List arcB1;   // ARC: ghosts of pages that left T1, the oldest first
+    BM_List arcB2;   // ARC: ghosts of pages that left T2
+    int arcP;   // ARC: target size of T1, moved by misses on ghosts
+    int *arcPrev;   // ARC: links of the frames in T1 and T2
+    int *arcNext;
+    bool *arcInT2;   // ARC: whether a frame is in T2
+    PageNumber *arcGhostPage;   // ARC: page of every ghost
+    int *arcGhostPrev;   // ARC: links of the ghosts in B1 and B2, next free ghost while unused
+    int *arcGhostNext;
+    bool *arcGhostInB2;   // ARC: whether a ghost is in B2
+    BM_PageMap arcGhosts;   // ARC: ghost of a page
+    int arcFreeGhost;   // ARC: first unused ghost
+    bool arcGhostHit;   // ARC: the page being loaded had a ghost, it goes to T2
+    SM_FileHandle fileHandle;   // Page file of the pool, opened on first I/O
+    SM_OpenMode ioMode;   // How the page file is opened
+    char *frameMemory;   // Page aligned memory of all the frames, frame i starts at i * pageSize
+    int pageSize;   // Page size of the page file, 0 until it is opened
+    int activeScans;   // Scans reading the page file once, see beginPoolScan
 } BufferPoolMgmtData;
 
 // convenience macros
@@ -55,6 +143,9 @@ typedef struct BufferPoolMgmtData {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolMode(BM_BufferPool *const bm, const char *const pageFileName,
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, SM_OpenMode ioMode);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -66,6 +157,15 @@ RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 		const PageNumber pageNum);
 RC pinPageFIFO(BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumber pageNum);
 RC pinPageLRU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC pinPageCLOCK(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC pinPageLFU(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC pinPageLRUK(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+RC pinPageARC(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+
+// Scans reading the page file once
+RC beginPoolScan (BM_BufferPool *const bm);
+RC endPoolScan (BM_BufferPool *const bm);
+RC releaseScannedPage (BM_BufferPool *const bm, const PageNumber pageNum);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -73,5 +173,6 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+RC getPoolFileStats (BM_BufferPool *const bm, SM_FileStats *stats);
 
 #endif
@@ -0,0 +1,70 @@
+#include "crc32c.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42
+#endif
+
+#define CRC32C_POLY 0x82F63B78u    // Castagnoli polynomial, bit reversed
+
+// Lookup table of the software fallback, filled once on first use
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void initCrcTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        crcTable[i] = crc;
+    }
+}
+
+// One byte at a time through the table
+static uint32_t crc32cTable(uint32_t crc, const unsigned char *data, size_t size) {
+    pthread_once(&crcTableOnce, initCrcTable);
+    for (size_t i = 0; i < size; i++)
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+// Eight bytes per crc32 instruction, the unaligned head and the tail byte by byte
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc, const unsigned char *data, size_t size) {
+    while (size > 0 && ((uintptr_t) data & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        size--;
+    }
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8)
+        crc64 = _mm_crc32_u64(crc64, *(const uint64_t *) data);
+    crc = (uint32_t) crc64;
+#else
+    for (; size >= 4; size -= 4, data += 4)
+        crc = _mm_crc32_u32(crc, *(const uint32_t *) data);
+#endif
+    while (size-- > 0)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#endif
+
+int crc32cHardware(void) {
+#ifdef CRC32C_HAVE_SSE42
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 0;
+#endif
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t size) {
+    crc = ~crc;
+#ifdef CRC32C_HAVE_SSE42
+    if (crc32cHardware())
+        return ~crc32cSse42(crc, (const unsigned char *) data, size);
+#endif
+    return ~crc32cTable(crc, (const unsigned char *) data, size);
+}
@@ -0,0 +1,17 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+// CRC32C (Castagnoli) of size bytes. Pass 0 as crc for a new checksum, or the
+// result of an earlier call to continue it over the following bytes.
+extern uint32_t crc32c (uint32_t crc, const void *data, size_t size);
+
+// Whether crc32c runs on the SSE4.2 crc32 instruction instead of the lookup table
+extern int crc32cHardware (void);
+
+#endif
@@ -14,6 +14,10 @@ typedef int RC;
 #define RC_FILE_HANDLE_NOT_INIT 2
 #define RC_WRITE_FAILED 3
 #define RC_READ_NON_EXISTING_PAGE 4
+#define RC_IO_QUEUE_FULL 5
+#define RC_CHECKSUM_MISMATCH 6
+#define RC_FILE_IN_USE 7
+#define RC_ALL_FRAMES_PINNED 8
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
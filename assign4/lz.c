@@ -0,0 +1,153 @@
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+#define HASH_BITS 12
+#define MAX_OFFSET 65535
+
+static uint32_t read32(const char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Hash of the 4 bytes a match has to start with
+static uint32_t hash4(const char *p) {
+    return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write a length that did not fit in its nibble, 255 at a time
+static char *writeLength(char *op, char *end, size_t length) {
+    while (length >= 255 && op < end) {
+        *op++ = (char) 255;
+        length -= 255;
+    }
+    if (op >= end)
+        return NULL;
+    *op++ = (char) length;
+    return op;
+}
+
+// Emit literals src[0..literals) followed by a match (matchLength 0: literals only).
+// Returns the new output position, NULL when out of room.
+static char *writeSequence(char *op, char *end, const char *literals, size_t numLiterals, size_t offset, size_t matchLength) {
+    if (op >= end)
+        return NULL;
+    char *token = op++;
+    size_t matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    *token = (char) (((numLiterals < 15 ? numLiterals : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if (numLiterals >= 15 && (op = writeLength(op, end, numLiterals - 15)) == NULL)
+        return NULL;
+    if ((size_t) (end - op) < numLiterals)
+        return NULL;
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+
+    if (matchLength == 0)
+        return op;
+    if (end - op < 2)
+        return NULL;
+    *op++ = (char) (offset & 0xFF);
+    *op++ = (char) (offset >> 8);
+    if (matchCode >= 15 && (op = writeLength(op, end, matchCode - 15)) == NULL)
+        return NULL;
+    return op;
+}
+
+size_t lzCompress(const char *src, size_t size, char *dst, size_t capacity) {
+    if (size > LZ_MAX_INPUT)
+        return 0;
+
+    int32_t table[1 << HASH_BITS];     // Last position seen for every hash
+    for (int i = 0; i < (1 << HASH_BITS); i++)
+        table[i] = -1;
+
+    char *op = dst;
+    char *end = dst + capacity;
+    size_t ip = 0, anchor = 0;
+
+    while (ip + LZ_MIN_MATCH <= size) {
+        uint32_t h = hash4(src + ip);
+        int32_t ref = table[h];
+        table[h] = (int32_t) ip;
+
+        if (ref < 0 || ip - ref > MAX_OFFSET || read32(src + ref) != read32(src + ip)) {
+            // Skip faster through data that does not compress
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        size_t length = LZ_MIN_MATCH;
+        while (ip + length < size && src[ref + length] == src[ip + length])
+            length++;
+
+        op = writeSequence(op, end, src + anchor, ip - anchor, ip - ref, length);
+        if (op == NULL)
+            return 0;
+        ip += length;
+        anchor = ip;
+    }
+
+    op = writeSequence(op, end, src + anchor, size - anchor, 0, 0);
+    return op == NULL ? 0 : (size_t) (op - dst);
+}
+
+// Read a length continued in extra bytes, -1 past the end of the input
+static long readLength(const unsigned char **ip, const unsigned char *end) {
+    long length = 0;
+    unsigned char byte;
+    do {
+        if (*ip >= end)
+            return -1;
+        byte = *(*ip)++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+long lzDecompress(const char *src, size_t size, char *dst, size_t capacity) {
+    const unsigned char *ip = (const unsigned char *) src;
+    const unsigned char *end = ip + size;
+    size_t op = 0;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+
+        long numLiterals = token >> 4;
+        if (numLiterals == 15) {
+            long more = readLength(&ip, end);
+            if (more < 0)
+                return -1;
+            numLiterals += more;
+        }
+        if (end - ip < numLiterals || capacity - op < (size_t) numLiterals)
+            return -1;
+        memcpy(dst + op, ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+
+        // The last sequence stops after its literals
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        long length = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15) {
+            long more = readLength(&ip, end);
+            if (more < 0)
+                return -1;
+            length += more;
+        }
+        if (offset == 0 || offset > op || capacity - op < (size_t) length)
+            return -1;
+
+        // Byte by byte, a match may overlap the bytes it produces
+        for (long i = 0; i < length; i++, op++)
+            dst[op] = dst[op - offset];
+    }
+    return (long) op;
+}
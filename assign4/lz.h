@@ -0,0 +1,26 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+// Byte oriented LZ77 codec for single pages (at most 64 KB of input).
+// The stream is a series of sequences: a token byte (literal count in the high
+// nibble, match length - LZ_MIN_MATCH in the low one, 15 meaning more length
+// bytes follow), the literals, then a 2 byte little endian match offset and the
+// extra match length bytes. The last sequence has literals only.
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_INPUT 65536
+
+// Compress size bytes of src into dst. Returns the compressed size, or 0 if
+// it would not fit in capacity bytes (the data is not worth compressing).
+extern size_t lzCompress (const char *src, size_t size, char *dst, size_t capacity);
+
+// Decompress size bytes of src into dst, which has room for capacity bytes.
+// Returns the decompressed size, or -1 if the input is malformed.
+extern long lzDecompress (const char *src, size_t size, char *dst, size_t capacity);
+
+#endif
@@ -0,0 +1,287 @@
+#define _GNU_SOURCE             // mremap
+#include "memory_backend.h"
+#include "dt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define INITIAL_CAPACITY 16     // Pages a memory file has room for before its mapping first grows
+
+// A page file in memory, shared by all handles opened on its name
+typedef struct SM_MemoryFile {
+    char *name;
+    int pageSize;
+    pthread_rwlock_t lock;  // Shared by reads and writes of existing pages, exclusive to grow or reset
+    char *pages;            // Anonymous mapping holding the pages one after the other
+    SM_BlockNum numPages;   // Pages the file has
+    SM_BlockNum capacity;   // Pages the mapping has room for, the ones past numPages are zero
+    int openHandles;
+    bool destroyed;         // Destroyed while open, freed with its last handle
+    struct SM_MemoryFile *next;
+} SM_MemoryFile;
+
+// Memory files by name
+static pthread_mutex_t filesLock = PTHREAD_MUTEX_INITIALIZER;
+static SM_MemoryFile *files = NULL;
+
+// Find a memory file, must hold filesLock
+static SM_MemoryFile *findFile(const char *name) {
+    for (SM_MemoryFile *file = files; file != NULL; file = file->next)
+        if (strcmp(file->name, name) == 0)
+            return file;
+    return NULL;
+}
+
+static void freeFile(SM_MemoryFile *file) {
+    munmap(file->pages, (size_t) file->capacity * file->pageSize);
+    pthread_rwlock_destroy(&file->lock);
+    free(file->name);
+    free(file);
+}
+
+// Grow a file to numPages zero filled pages, the mapping doubles when it runs out of room.
+// The handle growing it learns the new page count. Must hold the file's lock exclusively if it grows.
+static RC growFile(SM_MemoryFile *file, SM_FileHandle *fHandle, SM_BlockNum numPages) {
+    if (numPages <= file->numPages)
+        return RC_OK;
+
+    if (numPages > file->capacity) {
+        SM_BlockNum capacity = file->capacity;
+        while (capacity < numPages)
+            capacity *= 2;
+        void *pages = mremap(file->pages, (size_t) file->capacity * file->pageSize, (size_t) capacity * file->pageSize, MREMAP_MAYMOVE);
+        if (pages == MAP_FAILED)
+            return RC_WRITE_FAILED;
+        file->pages = (char *) pages;
+        file->capacity = capacity;
+    }
+    file->numPages = numPages;
+    fHandle->totalNumPages = numPages;
+    return RC_OK;
+}
+
+// Address of a page
+static char *pageAddress(SM_MemoryFile *file, SM_BlockNum pageNum) {
+    return file->pages + (size_t) pageNum * file->pageSize;
+}
+
+// Lock a file for writing pages up to lastPage, exclusively only if it has to grow
+static void lockForWrite(SM_MemoryFile *file, SM_BlockNum lastPage) {
+    pthread_rwlock_rdlock(&file->lock);
+    if (lastPage < file->numPages)
+        return;
+    pthread_rwlock_unlock(&file->lock);
+    pthread_rwlock_wrlock(&file->lock);
+}
+
+// Remember the page last read or written, threads sharing a handle each set it
+static void setPagePos(SM_FileHandle *fHandle, SM_BlockNum pageNum) {
+    __atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+}
+
+/* MANIPULATING PAGE FILES */
+/***************************/
+
+// Create a memory file with one empty page, or empty an existing one. Only the page size of the options
+// applies, a memory file has no segments, checksums or compression.
+static RC memCreatePageFile(char *fileName, const SM_FileOptions *options) {
+    int pageSize = (options != NULL && options->pageSize != 0) ? options->pageSize : PAGE_SIZE;
+    if (pageSize < SM_MIN_PAGE_SIZE || pageSize > SM_MAX_PAGE_SIZE || (pageSize & (pageSize - 1)) != 0)
+        return RC_WRITE_FAILED;
+
+    pthread_mutex_lock(&filesLock);
+    SM_MemoryFile *file = findFile(fileName);
+    if (file != NULL) {
+        // Like truncating a file: the pages are dropped, the kernel hands back zero pages when touched again
+        pthread_rwlock_wrlock(&file->lock);
+        RC rc = RC_OK;
+        if (file->pageSize != pageSize) {
+            rc = RC_WRITE_FAILED;   // Open handles rely on the page size
+        } else {
+            madvise(file->pages, (size_t) file->capacity * file->pageSize, MADV_DONTNEED);
+            file->numPages = 1;
+        }
+        pthread_rwlock_unlock(&file->lock);
+        pthread_mutex_unlock(&filesLock);
+        return rc;
+    }
+
+    file = (SM_MemoryFile *) calloc(1, sizeof(SM_MemoryFile));
+    char *name = strdup(fileName);
+    void *pages = mmap(NULL, (size_t) INITIAL_CAPACITY * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (file == NULL || name == NULL || pages == MAP_FAILED) {
+        if (pages != MAP_FAILED)
+            munmap(pages, (size_t) INITIAL_CAPACITY * pageSize);
+        free(name);
+        free(file);
+        pthread_mutex_unlock(&filesLock);
+        return RC_WRITE_FAILED;
+    }
+    file->name = name;
+    file->pageSize = pageSize;
+    pthread_rwlock_init(&file->lock, NULL);
+    file->pages = (char *) pages;
+    file->numPages = 1;
+    file->capacity = INITIAL_CAPACITY;
+    file->openHandles = 0;
+    file->destroyed = false;
+    file->next = files;
+    files = file;
+    pthread_mutex_unlock(&filesLock);
+    return RC_OK;
+}
+
+// Open a memory file, the mode and segment size do not apply
+static RC memOpenPageFile(char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode, SM_BlockNum segmentPages) {
+    pthread_mutex_lock(&filesLock);
+    SM_MemoryFile *file = findFile(fileName);
+    if (file == NULL) {
+        pthread_mutex_unlock(&filesLock);
+        return RC_FILE_NOT_FOUND;
+    }
+    file->openHandles++;
+    pthread_mutex_unlock(&filesLock);
+
+    pthread_rwlock_rdlock(&file->lock);
+    fHandle->totalNumPages = file->numPages;
+    pthread_rwlock_unlock(&file->lock);
+    fHandle->fileName = fileName;
+    fHandle->curPagePos = 0;
+    fHandle->pageSize = file->pageSize;
+    fHandle->mgmtInfo = file;
+    return RC_OK;
+}
+
+static RC memClosePageFile(SM_FileHandle *fHandle) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+
+    pthread_mutex_lock(&filesLock);
+    if (--file->openHandles == 0 && file->destroyed)
+        freeFile(file);
+    pthread_mutex_unlock(&filesLock);
+
+    fHandle->mgmtInfo = NULL;
+    return RC_OK;
+}
+
+// Drop a memory file, its memory goes once no handle uses it
+static RC memDestroyPageFile(char *fileName) {
+    pthread_mutex_lock(&filesLock);
+    SM_MemoryFile **link = &files;
+    while (*link != NULL && strcmp((*link)->name, fileName) != 0)
+        link = &(*link)->next;
+    SM_MemoryFile *file = *link;
+    if (file == NULL) {
+        pthread_mutex_unlock(&filesLock);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    *link = file->next;
+    if (file->openHandles == 0)
+        freeFile(file);
+    else
+        file->destroyed = true;
+    pthread_mutex_unlock(&filesLock);
+    return RC_OK;
+}
+
+/* READING AND WRITING BLOCKS */
+/******************************/
+
+static RC memReadBlocks(SM_BlockNum startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+
+    pthread_rwlock_rdlock(&file->lock);
+    if (startPageNum < 0 || numPages < 0 || startPageNum + numPages > file->numPages) {
+        pthread_rwlock_unlock(&file->lock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    for (int i = 0; i < numPages; i++)
+        memcpy(memPages[i], pageAddress(file, startPageNum + i), file->pageSize);
+    pthread_rwlock_unlock(&file->lock);
+
+    if (numPages > 0)
+        setPagePos(fHandle, startPageNum + numPages - 1);
+    return RC_OK;
+}
+
+static RC memReadBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    return memReadBlocks(pageNum, 1, fHandle, &memPage);
+}
+
+// Write blocks in the order given, so the last buffer given for a page wins. Pages past the end grow the file.
+static RC memWriteBlocks(SM_BlockRef *blocks, int numBlocks, SM_FileHandle *fHandle) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+    if (numBlocks <= 0)
+        return RC_OK;
+
+    SM_BlockNum lastPage = 0;
+    for (int i = 0; i < numBlocks; i++) {
+        if (blocks[i].pageNum < 0)
+            return RC_WRITE_FAILED;
+        if (blocks[i].pageNum > lastPage)
+            lastPage = blocks[i].pageNum;
+    }
+
+    lockForWrite(file, lastPage);
+    RC rc = growFile(file, fHandle, lastPage + 1);
+    if (rc == RC_OK)
+        for (int i = 0; i < numBlocks; i++)
+            memcpy(pageAddress(file, blocks[i].pageNum), blocks[i].memPage, file->pageSize);
+    pthread_rwlock_unlock(&file->lock);
+
+    if (rc == RC_OK)
+        setPagePos(fHandle, lastPage);
+    return rc;
+}
+
+// Writing one page past the end appends it, anything further is an error
+static RC memWriteBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+    SM_BlockRef block = { pageNum, memPage };
+
+    pthread_rwlock_rdlock(&file->lock);
+    bool inRange = pageNum >= 0 && pageNum <= file->numPages;
+    pthread_rwlock_unlock(&file->lock);
+    if (!inRange)
+        return RC_WRITE_FAILED;
+    return memWriteBlocks(&block, 1, fHandle);
+}
+
+static RC memEnsureCapacity(SM_BlockNum numberOfPages, SM_FileHandle *fHandle) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+
+    lockForWrite(file, numberOfPages - 1);
+    RC rc = growFile(file, fHandle, numberOfPages);
+    pthread_rwlock_unlock(&file->lock);
+    return rc;
+}
+
+static RC memAppendEmptyBlock(SM_FileHandle *fHandle) {
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+
+    pthread_rwlock_wrlock(&file->lock);
+    RC rc = growFile(file, fHandle, file->numPages + 1);
+    pthread_rwlock_unlock(&file->lock);
+    return rc;
+}
+
+// Memory pages do not outlive the process, there is nothing to make durable
+static RC memSyncPageFile(SM_FileHandle *fHandle) {
+    return RC_OK;
+}
+
+const SM_Backend memoryBackend = {
+    .createPageFile = memCreatePageFile,
+    .openPageFile = memOpenPageFile,
+    .closePageFile = memClosePageFile,
+    .destroyPageFile = memDestroyPageFile,
+    .readBlock = memReadBlock,
+    .writeBlock = memWriteBlock,
+    .readBlocks = memReadBlocks,
+    .writeBlocks = memWriteBlocks,
+    .appendEmptyBlock = memAppendEmptyBlock,
+    .ensureCapacity = memEnsureCapacity,
+    .syncPageFile = memSyncPageFile
+};
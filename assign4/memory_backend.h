@@ -0,0 +1,14 @@
+#ifndef MEMORY_BACKEND_H
+#define MEMORY_BACKEND_H
+
+#include "storage_mgr.h"
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+// Storage backend keeping page files in anonymous memory, used for names
+// starting with SM_MEMORY_PREFIX. A memory page file lives until it is
+// destroyed or the process ends, handles opened on it share its pages.
+extern const SM_Backend memoryBackend;
+
+#endif
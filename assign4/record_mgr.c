@@ -20,7 +20,6 @@ RecordManager* record_mgr;  // Global pointer to Record Manager
 
 // Constants 
 #define MAX_NUMBER_OF_PAGES 10
-#define PAGE_SIZE 4096  // Example size for pages, adjust as needed
 
 // Initialize the record manager.
 RC initRecordManager(void* mgmtData) {
@@ -60,6 +59,11 @@ RC shutdownRecordManager() {
     //     ...
     // |-----------------------|
 extern RC createTable(char *name, Schema *schema) {
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+// Same as createTable with pages of pageSize bytes, large pages suit tables that are mostly scanned
+extern RC createTableWithPageSize(char *name, Schema *schema, int pageSize) {
     if (name == NULL) {
         printf("Error: Table name is NULL.\n");
         return -99;
@@ -78,7 +82,11 @@ extern RC createTable(char *name, Schema *schema) {
         return rc;
     }
 
-    char data[PAGE_SIZE];
+    char *data = (char *) calloc(1, pageSize);
+    if (data == NULL) {
+        printf("Error: Memory allocation failed for the table header page.\n");
+        return -99;
+    }
     char *page_handle_ptr = data;
 
     *(int *)page_handle_ptr = 0;  // Initialize number of records
@@ -96,6 +104,7 @@ extern RC createTable(char *name, Schema *schema) {
     for (int i = 0; i < schema->numAttr; i++) {
         if (schema->attrNames[i] == NULL) {
             printf("Error: Attribute name for attribute %d is NULL.\n", i);
+            free(data);
             return -99;
         }
         int nameLength = strlen(schema->attrNames[i]) + 1;
@@ -113,19 +122,23 @@ extern RC createTable(char *name, Schema *schema) {
     }
 
     SM_FileHandle fileHandle;
-    rc = createPageFile(name);
+    SM_FileOptions options = { .pageSize = pageSize };
+    rc = createPageFileOptions(name, &options);
     if (rc != RC_OK) {
         printf("Error: Failed to create page file '%s' with error code %d.\n", name, rc);
+        free(data);
         return rc;
     }
 
     rc = openPageFile(name, &fileHandle);
     if (rc != RC_OK) {
         printf("Error: Failed to open page file '%s' with error code %d.\n", name, rc);
+        free(data);
         return rc;
     }
     SM_PageHandle pageHandle = data;  // Point to data directly
     rc = writeBlock(0, &fileHandle, pageHandle);
+    free(data);
     if (rc != RC_OK) {
         printf("Error: Failed to write to block 0 of file '%s' with error code %d.\n", name, rc);
         closePageFile(&fileHandle);
@@ -168,6 +181,10 @@ RC openTable(RM_TableData *rel, char *name) {
         return rc;
     }
 
+    // The file only had to exist, page access goes through the buffer pool
+    int pageSize = fileHandle.pageSize;
+    int numPages = fileHandle.totalNumPages;
+    closePageFile(&fileHandle);
 
     // Allocate and copy the table's name
     rel->name = (char *) malloc(strlen(name) + 1);
@@ -278,6 +295,13 @@ RC openTable(RM_TableData *rel, char *name) {
     rel->schema = schema;
     rel->mgmtData->recordSize = getRecordSize(schema);
 
+    // As many records per page as the page size of the table allows
+    rel->mgmtData->numRecords = pageSize / rel->mgmtData->recordSize;
+
+    // Records are read through the record manager's pool, scans cover every slot of the file's pages
+    rel->mgmtData->bufferManager = &record_mgr->bufferPool;
+    rel->mgmtData->totalNumRecords = numPages * rel->mgmtData->numRecords;
+
     // Unpin and free resources
     rc = unpinPage(&record_mgr->bufferPool, pageHandle);
     if (rc != RC_OK) {
@@ -512,6 +536,9 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     scanData->currentRecord.page = 1;     // Start at the first page
     scanData->currentRecord.slot = 0;     // Start at the first slot in the page
     scanData->condition = cond;    // Set the condition for filtering records
+    scanData->oneShot = false;
+    scanData->scanPage = -1;
+    scanData->pageLoaded = false;
 
     // Attach the scan data to the scan handle
     scan->mgmtData = scanData;
@@ -519,6 +546,26 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     return RC_OK;
 }
 
+// Same as startScan for a scan reading the whole table once, like a report. The pages it reads
+// itself leave the buffer pool and the OS page cache once it is past them, so the pages other
+// work keeps using stay cached.
+RC startOneShotScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
+    RC rc = startScan(rel, scan, cond);
+    if (rc != RC_OK) return rc;
+
+    scan->mgmtData->oneShot = true;
+    beginPoolScan(rel->mgmtData->bufferManager);  // Only a hint, the scan works without it
+    return RC_OK;
+}
+
+// A one-shot scan moved on to another page: let go of the page it was on if it read it itself
+static void passScanPage(BM_BufferPool *bm, ScanMgmtData *scanData, int pageNum, bool loaded) {
+    if (scanData->scanPage >= 0 && scanData->pageLoaded)
+        releaseScannedPage(bm, scanData->scanPage);
+    scanData->scanPage = pageNum;
+    scanData->pageLoaded = loaded;
+}
+
 RC next(RM_ScanHandle *scan, Record *record) {
     RM_TableData *rel = scan->rel;
     ScanMgmtData *scanData = (ScanMgmtData *)scan->mgmtData;
@@ -538,9 +585,14 @@ RC next(RM_ScanHandle *scan, Record *record) {
         int slot = recordIndex % recordsPerPage;
 
         // Pin the page where the current record is located
+        int readsBefore = getNumReadIO(bm);
         RC rc = pinPage(bm, &page, pageNum);
         if (rc != RC_OK) return rc;
 
+        // A one-shot scan remembers whether it read the page or found it in the pool
+        if (scanData->oneShot && pageNum != scanData->scanPage)
+            passScanPage(bm, scanData, pageNum, getNumReadIO(bm) > readsBefore);
+
         // Calculate the offset within the page
         char *pageData = page.data;
         int offset = slot * recordSize;
@@ -582,6 +634,13 @@ RC next(RM_ScanHandle *scan, Record *record) {
 }
 
 RC closeScan(RM_ScanHandle *scan) {
+    // A one-shot scan lets go of its last page
+    if (scan->mgmtData != NULL && scan->mgmtData->oneShot) {
+        BM_BufferPool *bm = scan->rel->mgmtData->bufferManager;
+        passScanPage(bm, scan->mgmtData, -1, false);
+        endPoolScan(bm);
+    }
+
     // Free the scan management data
     if (scan->mgmtData != NULL) {
         free(scan->mgmtData);
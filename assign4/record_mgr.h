@@ -10,6 +10,9 @@ typedef struct ScanMgmtData
 {
 	RID currentRecord;        
     Expr *condition;        
+    bool oneShot;           // Started by startOneShotScan, pages the scan read are dropped once it is past them
+    int scanPage;           // Page the scan is on, -1 before its first
+    bool pageLoaded;        // The scan read scanPage into the buffer pool itself rather than finding it there
 } ScanMgmtData;
 
 // Bookkeeping for scans
@@ -24,6 +27,7 @@ typedef struct RM_ScanHandle
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
@@ -37,6 +41,7 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startOneShotScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
 extern RC next (RM_ScanHandle *scan, Record *record);
 extern RC closeScan (RM_ScanHandle *scan);
 
@@ -1,265 +1,2750 @@
+#define _GNU_SOURCE             // O_DIRECT
+#define _FILE_OFFSET_BITS 64    // 64 bit file offsets on 32 bit platforms too
 #include "storage_mgr.h"
+#include "crc32c.h"
+#include "lz.h"
+#include "memory_backend.h"
+#include "dt.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
-#define PAGE_SIZE 4096  // Define the page size as 4096 bytes
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define SM_HAVE_IO_URING
+#endif
+#endif
+#include <sys/types.h>
+
+#define DIRECT_IO_ALIGNMENT 4096    // O_DIRECT memory, offsets and lengths are multiples of this
+
+#define SM_FILE_MAGIC "SMPAGEF1"    // Starts the header of every page file
+#define SM_FILE_VERSION 1
+
+// Header flags
+#define SM_HEADER_CHECKSUMS 1   // A CRC32C of every page is kept in <fileName>.crc
+#define SM_HEADER_COMPRESSED 2  // Pages are stored compressed, <fileName>.map says where
+
+#define SLOT_ALIGNMENT 256      // Compressed pages get slots of a multiple of this, so they can grow a little in place
+
+// Where a compressed page is stored, one entry per page in <fileName>.map
+typedef struct SM_PageSlot {
+    uint64_t offset;    // Start of the slot in the page file
+    uint32_t length;    // Bytes of the compressed page, 0 for an empty page, the page size for a page stored as it is
+    uint32_t capacity;  // Bytes of the slot
+} SM_PageSlot;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024    // Most buffers a single preadv/pwritev accepts on Linux
+#endif
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// What the first SM_HEADER_SIZE bytes of a page file hold, the rest of the header is zero
+typedef struct SM_FileHeader {
+    char magic[8];              // SM_FILE_MAGIC, files without it are headerless files of PAGE_SIZE pages
+    int version;                // SM_FILE_VERSION
+    int pageSize;               // Bytes per page, chosen when the file was created
+    SM_BlockNum segmentPages;   // Pages per segment file, 0 when the page file is a single file
+    int flags;                  // SM_HEADER_ flags
+} SM_FileHeader;
+
+// A sync that failed, kept until each caller it covered was told
+typedef struct SM_FailedSync {
+    unsigned long long from;        // Tickets in (from, through] were covered by the sync
+    unsigned long long through;
+    unsigned long long unreported;  // Callers of those tickets that have not returned yet
+} SM_FailedSync;
+
+// Per-handle bookkeeping kept in SM_FileHandle->mgmtInfo. Threads may share a handle: reads and
+// in-place writes hold the lock shared, anything that grows the file or moves pages holds it exclusively.
+typedef struct SM_FileMgmtInfo {
+    pthread_rwlock_t lock;      // Guards the handle and everything below
+    pthread_mutex_t segmentLock;    // Guards segmentFds, segments are opened under a shared lock
+    int fd;             // Descriptor opened once by openPageFile and released by closePageFile
+    SM_OpenMode mode;   // How blocks are accessed
+    int pageSize;       // Bytes per page
+    off_t headerSize;   // Bytes before the first page, SM_HEADER_SIZE or 0 for a headerless file
+    char *map;          // SM_MODE_MMAP: start of the mapping, NULL while nothing is mapped
+    SM_BlockNum mapPages;       // SM_MODE_MMAP: pages covered by the mapping (can be more than the file has)
+    SM_BlockNum allocatedPages; // Pages reserved on disk, the file can grow up to here without allocating
+    SM_BlockNum extentPages;    // Growth policy: pages reserved at once when the file runs out of reserved space
+    bool geometric;     // Growth policy: reserve as much again as the file already has when that is more
+    char *fileName;     // Name of the first segment (fd), the others are <fileName>.1, <fileName>.2, ...
+    SM_BlockNum segmentPages;   // Pages per segment file, 0 when the page file is a single file
+    int *segmentFds;    // Descriptors of the other segments by segment number, -1 until first used
+    int numSegmentFds;  // Entries in segmentFds
+    bool checksums;     // The file keeps a checksum of every page
+    bool verifyChecksums;       // Reads compare pages against their checksums
+    int checksumFd;     // Descriptor of the checksum file, -1 for a file without checksums
+    uint32_t *pageChecksums;    // Checksum of every page by page number, 0 for a page never written
+    SM_BlockNum checksumSlots;  // Entries in pageChecksums
+    bool compressed;    // Pages are stored compressed in variable size slots
+    int mapFd;          // Descriptor of the page map of a compressed file, -1 otherwise
+    SM_PageSlot *pageSlots;     // Slot of every page by page number
+    SM_BlockNum numPageSlots;   // Entries in pageSlots
+    off_t dataEnd;      // End of the last slot, new slots go here
+    int freeMapFd;      // Descriptor of <fileName>.fsm, -1 until a page is freed
+    uint64_t *freeMap;  // One bit per page, set for a free page
+    SM_BlockNum freeMapWords;   // Words in freeMap
+    SM_BlockNum firstFreeWord;  // No free page before this word of freeMap
+    pthread_mutex_t readAheadLock;  // Guards the scan detection below
+    int readAheadPages;         // Pages read ahead of a scan, 0 turns read-ahead off
+    SM_BlockNum nextSequentialPage; // Page a read continuing the last one starts at
+    int sequentialReads;        // Reads in a row that continued the one before
+    SM_BlockNum prefetchedEnd;  // Read-ahead of the current scan was issued up to here
+    bool sequentialHint;        // The kernel was told the file is read in order, see setSequentialHint
+    SM_BlockNum scanStart;      // First page of the current scan
+    SM_BlockNum droppedEnd;     // Under the sequential hint the scan's pages were dropped from the page cache up to here
+    pthread_mutex_t syncLock;   // Guards the group commit state below
+    pthread_cond_t syncDone;    // Broadcast whenever a sync finishes
+    unsigned long long syncRequests;    // syncPageFile calls so far, the count at a call is its ticket
+    unsigned long long syncedRequests;  // Tickets up to here are durable
+    bool syncing;               // A caller is syncing for everyone waiting
+    SM_FailedSync *failedSyncs; // Failed syncs with callers still to tell, one entry each
+    int numFailedSyncs;         // Entries in failedSyncs
+    int groupCommitDelay;       // Microseconds the syncing caller waits for others to join its sync
+    unsigned long long lastGroupSize;   // Callers the last sync was done for
+    int pendingRequests;        // Asynchronous requests on the handle not completed yet, closing waits for none
+} SM_FileMgmtInfo;
+
+// Default growth policy, 64 KB extents
+#define DEFAULT_EXTENT_PAGES 16
+
+// Default read-ahead window, 128 KB of 4 KB pages
+#define DEFAULT_READ_AHEAD_PAGES 32
+
+// Descriptors of files no handle uses that stay open by default, see setDescriptorCacheSize
+#define DEFAULT_FD_CACHE_SIZE 64
+
+// A descriptor of a page file or segment, shared by every handle of that file
+typedef struct SM_CachedFd {
+    char *name;         // File the descriptor was opened on
+    bool direct;        // Opened with O_DIRECT, such descriptors are only shared among direct handles
+    int fd;
+    int refCount;       // Handles using the descriptor, 0 while it waits in the cache
+    bool stale;         // The file was destroyed or recreated, closed with its last handle
+    struct SM_CachedFd *prev, *next;    // Cache list, most recently used first
+} SM_CachedFd;
+
+// All descriptors of the process, the lock guards the list and the counts
+static pthread_mutex_t fdCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static SM_CachedFd *fdCacheHead = NULL;
+static SM_CachedFd *fdCacheTail = NULL;
+static int fdCacheIdle = 0;     // Entries with no handle
+static int fdCacheSize = DEFAULT_FD_CACHE_SIZE;
+
+// Set up the bookkeeping of a freshly opened descriptor
+static void initMgmtInfo(SM_FileMgmtInfo *info, int fd, SM_OpenMode mode, SM_BlockNum totalNumPages) {
+    memset(info, 0, sizeof(SM_FileMgmtInfo));
+    pthread_rwlock_init(&info->lock, NULL);
+    pthread_mutex_init(&info->segmentLock, NULL);
+    pthread_mutex_init(&info->readAheadLock, NULL);
+    pthread_mutex_init(&info->syncLock, NULL);
+    pthread_cond_init(&info->syncDone, NULL);
+    info->fd = fd;
+    info->mode = mode;
+    info->pageSize = PAGE_SIZE;
+    info->headerSize = SM_HEADER_SIZE;
+    info->map = NULL;
+    info->allocatedPages = totalNumPages;
+    info->extentPages = DEFAULT_EXTENT_PAGES;
+    info->geometric = false;
+    info->fileName = NULL;
+    info->segmentPages = 0;
+    info->segmentFds = NULL;
+    info->numSegmentFds = 0;
+    info->checksums = false;
+    info->verifyChecksums = false;
+    info->checksumFd = -1;
+    info->pageChecksums = NULL;
+    info->checksumSlots = 0;
+    info->compressed = false;
+    info->mapFd = -1;
+    info->pageSlots = NULL;
+    info->numPageSlots = 0;
+    info->dataEnd = 0;
+    info->freeMapFd = -1;
+    info->freeMap = NULL;
+    info->freeMapWords = 0;
+    info->firstFreeWord = 0;
+    info->readAheadPages = DEFAULT_READ_AHEAD_PAGES;
+    info->nextSequentialPage = -1;
+    info->sequentialReads = 0;
+    info->prefetchedEnd = 0;
+    info->sequentialHint = false;
+    info->scanStart = 0;
+    info->droppedEnd = 0;
+    info->syncRequests = 0;
+    info->syncedRequests = 0;
+    info->syncing = false;
+    info->failedSyncs = NULL;
+    info->numFailedSyncs = 0;
+    info->groupCommitDelay = 0;
+    info->lastGroupSize = 0;
+}
+
+static const SM_Backend fileBackend;
+
+// Get the bookkeeping of an open handle, NULL if the handle was never opened or is not backed by a file
+static SM_FileMgmtInfo *getMgmtInfo(SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->backend != &fileBackend)
+        return NULL;
+    return (SM_FileMgmtInfo *) fHandle->mgmtInfo;
+}
+
+// Lock a handle for writing pages up to lastPage. Pages that are there and stay in place are written
+// under the shared lock, so writers of different pages run in parallel. Growing the file or moving
+// compressed pages takes the lock exclusively.
+static void lockForWrite(SM_FileHandle *fHandle, SM_FileMgmtInfo *info, SM_BlockNum lastPage) {
+    pthread_rwlock_rdlock(&info->lock);
+    if (lastPage < fHandle->totalNumPages && !info->compressed)
+        return;
+    pthread_rwlock_unlock(&info->lock);
+    pthread_rwlock_wrlock(&info->lock);
+}
+
+// Remember the page last read or written. Threads sharing a handle each set it, the last one wins.
+static void setPagePos(SM_FileHandle *fHandle, SM_BlockNum pageNum) {
+    __atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+}
+
+/* Descriptor cache */
+
+// Take an entry out of the cache list
+static void unlinkCachedFd(SM_CachedFd *entry) {
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        fdCacheHead = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        fdCacheTail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+// Put an entry in front of the cache list
+static void pushCachedFd(SM_CachedFd *entry) {
+    entry->prev = NULL;
+    entry->next = fdCacheHead;
+    if (fdCacheHead != NULL)
+        fdCacheHead->prev = entry;
+    else
+        fdCacheTail = entry;
+    fdCacheHead = entry;
+}
+
+// Close an entry's descriptor and free it. Returns what close returned.
+static int dropCachedFd(SM_CachedFd *entry) {
+    unlinkCachedFd(entry);
+    if (entry->refCount == 0)
+        fdCacheIdle--;
+    int closed = close(entry->fd);
+    free(entry->name);
+    free(entry);
+    return closed;
+}
+
+// Close the least recently used idle descriptors until at most keep are left.
+// Must hold fdCacheLock.
+static void evictIdleFds(int keep) {
+    SM_CachedFd *entry = fdCacheTail;
+    while (entry != NULL && fdCacheIdle > keep) {
+        SM_CachedFd *prev = entry->prev;
+        if (entry->refCount == 0)
+            dropCachedFd(entry);
+        entry = prev;
+    }
+}
+
+// Get a descriptor of a file for one more handle: the cached one if any, else a newly opened one.
+// Returns -1 if the file cannot be opened.
+static int acquireFd(const char *name, bool direct, bool create) {
+    pthread_mutex_lock(&fdCacheLock);
+    for (SM_CachedFd *entry = fdCacheHead; entry != NULL; entry = entry->next) {
+        if (entry->stale || entry->direct != direct || strcmp(entry->name, name) != 0)
+            continue;
+        if (entry->refCount++ == 0)
+            fdCacheIdle--;
+        unlinkCachedFd(entry);
+        pushCachedFd(entry);
+        pthread_mutex_unlock(&fdCacheLock);
+        return entry->fd;
+    }
+
+    // Out of descriptors: the idle ones are the ones to give up
+    int flags = O_RDWR | (direct ? O_DIRECT : 0) | (create ? O_CREAT : 0);
+    int fd = open(name, flags, 0644);
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE) && fdCacheIdle > 0) {
+        evictIdleFds(0);
+        fd = open(name, flags, 0644);
+    }
+
+    SM_CachedFd *entry = fd >= 0 ? (SM_CachedFd *) malloc(sizeof(SM_CachedFd)) : NULL;
+    char *nameCopy = entry != NULL ? strdup(name) : NULL;
+    if (nameCopy == NULL) {
+        free(entry);
+        if (fd >= 0)
+            close(fd);
+        pthread_mutex_unlock(&fdCacheLock);
+        return -1;
+    }
+    entry->name = nameCopy;
+    entry->direct = direct;
+    entry->fd = fd;
+    entry->refCount = 1;
+    entry->stale = false;
+    pushCachedFd(entry);
+    pthread_mutex_unlock(&fdCacheLock);
+    return fd;
+}
+
+// A handle is done with a descriptor, it stays open for the next handle of the file.
+// Returns 0, or what close returned if the descriptor had to be closed.
+static int releaseFd(int fd) {
+    int closed = 0;
+    pthread_mutex_lock(&fdCacheLock);
+    SM_CachedFd *entry = fdCacheHead;
+    while (entry != NULL && entry->fd != fd)
+        entry = entry->next;
+    if (entry == NULL) {
+        closed = close(fd);
+    } else if (--entry->refCount == 0) {
+        fdCacheIdle++;
+        if (entry->stale)
+            closed = dropCachedFd(entry);
+        else
+            evictIdleFds(fdCacheSize);
+    }
+    pthread_mutex_unlock(&fdCacheLock);
+    return closed;
+}
+
+// The file and its segments are going away, no new handle may get their cached descriptors
+static void forgetFds(const char *fileName) {
+    size_t length = strlen(fileName);
+    pthread_mutex_lock(&fdCacheLock);
+    SM_CachedFd *entry = fdCacheHead;
+    while (entry != NULL) {
+        SM_CachedFd *next = entry->next;
+        // Segments are named <fileName>.N
+        if (strncmp(entry->name, fileName, length) == 0 && (entry->name[length] == '\0' || entry->name[length] == '.')) {
+            if (entry->refCount == 0)
+                dropCachedFd(entry);
+            else
+                entry->stale = true;
+        }
+        entry = next;
+    }
+    pthread_mutex_unlock(&fdCacheLock);
+}
+
+// Name of a segment file, segment 0 is the page file itself
+static void segmentFileName(char *fileName, SM_BlockNum segment, char *name, size_t size) {
+    if (segment == 0)
+        snprintf(name, size, "%s", fileName);
+    else
+        snprintf(name, size, "%s.%lld", fileName, segment);
+}
+
+// Remove the segment files following the first one
+static void removeSegments(char *fileName) {
+    char name[PATH_MAX];
+    for (SM_BlockNum segment = 1; ; segment++) {
+        segmentFileName(fileName, segment, name, sizeof(name));
+        if (remove(name) != 0)
+            break;
+    }
+}
+
+// Get the descriptor of a segment, opening it on first use. Returns -1 if it cannot be opened.
+static int segmentFd(SM_FileMgmtInfo *info, SM_BlockNum segment, bool create) {
+    if (segment == 0)
+        return info->fd;
+
+    pthread_mutex_lock(&info->segmentLock);
+    if (segment >= info->numSegmentFds) {
+        int numFds = info->numSegmentFds > 0 ? info->numSegmentFds : 4;
+        while (numFds <= segment)
+            numFds *= 2;
+        int *fds = (int *) realloc(info->segmentFds, numFds * sizeof(int));
+        if (fds == NULL) {
+            pthread_mutex_unlock(&info->segmentLock);
+            return -1;
+        }
+        for (int i = info->numSegmentFds; i < numFds; i++)
+            fds[i] = -1;
+        info->segmentFds = fds;
+        info->numSegmentFds = numFds;
+    }
+
+    if (info->segmentFds[segment] < 0) {
+        char name[PATH_MAX];
+        segmentFileName(info->fileName, segment, name, sizeof(name));
+        info->segmentFds[segment] = acquireFd(name, info->mode == SM_MODE_DIRECT, create);
+        if (info->segmentFds[segment] >= 0 && info->sequentialHint)
+            posix_fadvise(info->segmentFds[segment], 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    int fd = info->segmentFds[segment];
+    pthread_mutex_unlock(&info->segmentLock);
+    return fd;
+}
+
+// Find the descriptor holding a page and the byte offset of the page in it
+static int pageLocation(SM_FileMgmtInfo *info, SM_BlockNum pageNum, bool create, off_t *offset) {
+    if (info->segmentPages == 0) {
+        *offset = info->headerSize + (off_t) pageNum * info->pageSize;
+        return info->fd;
+    }
+
+    // Only the first segment starts with the header
+    SM_BlockNum segment = pageNum / info->segmentPages;
+    *offset = (segment == 0 ? info->headerSize : 0) + (off_t) (pageNum % info->segmentPages) * info->pageSize;
+    return segmentFd(info, segment, create);
+}
+
+// How many of numPages pages starting at startPage lie in the segment of startPage
+static SM_BlockNum pagesInSegment(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    if (info->segmentPages == 0)
+        return numPages;
+    SM_BlockNum left = info->segmentPages - startPage % info->segmentPages;
+    return numPages < left ? numPages : left;
+}
+
+// Bytes of a mapping covering the header and numPages pages
+static size_t mapSize(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    return (size_t) info->headerSize + (size_t) numPages * info->pageSize;
+}
+
+// Address of a page in the mapping
+static char *mappedPage(SM_FileMgmtInfo *info, SM_BlockNum pageNum) {
+    return info->map + mapSize(info, pageNum);
+}
+
+// Name of a file kept beside a page file, like its checksums (".crc") or its page map (".map")
+static void sidecarFileName(char *fileName, const char *suffix, char *name, size_t size) {
+    snprintf(name, size, "%s%s", fileName, suffix);
+}
+
+// Checksum kept for a page. 0 marks a page never written, so a page whose CRC is 0 is stored as 1.
+static uint32_t pageChecksum(SM_FileMgmtInfo *info, const char *memPage) {
+    uint32_t crc = crc32c(0, memPage, info->pageSize);
+    return crc != 0 ? crc : 1;
+}
+
+// Make room for the checksums of numPages pages, new entries are 0
+static RC growChecksums(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    if (!info->checksums || numPages <= info->checksumSlots)
+        return RC_OK;
+
+    SM_BlockNum slots = info->checksumSlots > 0 ? info->checksumSlots : 16;
+    while (slots < numPages)
+        slots *= 2;
+    uint32_t *checksums = (uint32_t *) realloc(info->pageChecksums, slots * sizeof(uint32_t));
+    if (checksums == NULL)
+        return RC_WRITE_FAILED;
+    memset(checksums + info->checksumSlots, 0, (slots - info->checksumSlots) * sizeof(uint32_t));
+    info->pageChecksums = checksums;
+    info->checksumSlots = slots;
+    return RC_OK;
+}
+
+// Remember the checksums of numPages pages just written from startPage on, in memory and in the checksum file
+static RC recordChecksums(SM_FileMgmtInfo *info, SM_BlockNum startPage, int numPages, SM_PageHandle *memPages) {
+    if (!info->checksums)
+        return RC_OK;
+
+    for (int i = 0; i < numPages; i++)
+        info->pageChecksums[startPage + i] = pageChecksum(info, memPages[i]);
+
+    size_t size = (size_t) numPages * sizeof(uint32_t);
+    off_t offset = (off_t) startPage * sizeof(uint32_t);
+    if (pwrite(info->checksumFd, info->pageChecksums + startPage, size, offset) != (ssize_t) size)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+// Compare numPages pages just read from startPage on against their checksums
+static RC verifyChecksums(SM_FileMgmtInfo *info, SM_BlockNum startPage, int numPages, SM_PageHandle *memPages) {
+    if (!info->checksums || !info->verifyChecksums)
+        return RC_OK;
+
+    for (int i = 0; i < numPages; i++) {
+        uint32_t stored = info->pageChecksums[startPage + i];
+        if (stored != 0 && stored != pageChecksum(info, memPages[i]))
+            return RC_CHECKSUM_MISMATCH;
+    }
+    return RC_OK;
+}
+
+// Load the checksums of a file opened with checksums, numPages pages at least
+static RC loadChecksums(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    char name[PATH_MAX];
+    sidecarFileName(info->fileName, ".crc", name, sizeof(name));
+    info->checksumFd = open(name, O_RDWR | O_CREAT, 0644);
+    struct stat fileInfo;
+    if (info->checksumFd < 0 || fstat(info->checksumFd, &fileInfo) != 0)
+        return RC_FILE_NOT_FOUND;
+
+    SM_BlockNum stored = fileInfo.st_size / sizeof(uint32_t);
+    RC rc = growChecksums(info, stored > numPages ? stored : numPages);
+    if (rc != RC_OK)
+        return rc;
+    size_t size = (size_t) stored * sizeof(uint32_t);
+    if (size > 0 && pread(info->checksumFd, info->pageChecksums, size, 0) != (ssize_t) size)
+        return RC_FILE_NOT_FOUND;
+    return RC_OK;
+}
+
+// Make sure the mapping covers at least numPages pages. The mapping is grown by doubling
+// so appending page after page only remaps a logarithmic number of times.
+static RC mapPages(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    if (numPages <= info->mapPages)
+        return RC_OK;
+
+    SM_BlockNum newMapPages = info->mapPages > 0 ? info->mapPages : 1;
+    while (newMapPages < numPages)
+        newMapPages *= 2;
+
+    // Pages past the end of the file are never touched, they only reserve address space
+    void *map = mmap(NULL, mapSize(info, newMapPages), PROT_READ | PROT_WRITE, MAP_SHARED, info->fd, 0);
+    if (map == MAP_FAILED)
+        return RC_FILE_HANDLE_NOT_INIT;     // The old mapping stays usable
+
+    if (info->map != NULL)
+        munmap(info->map, mapSize(info, info->mapPages));
+
+    info->map = (char *) map;
+    info->mapPages = newMapPages;
+    return RC_OK;
+}
+
+// Cut the mapping down to numPages pages after the file shrank, it keeps covering at least one.
+// The old mapping stays in place if the new one cannot be made.
+static RC unmapPagesPast(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    SM_BlockNum newMapPages = numPages > 0 ? numPages : 1;
+    if (info->map == NULL || newMapPages >= info->mapPages)
+        return RC_OK;
+
+    void *map = mmap(NULL, mapSize(info, newMapPages), PROT_READ | PROT_WRITE, MAP_SHARED, info->fd, 0);
+    if (map == MAP_FAILED)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    munmap(info->map, mapSize(info, info->mapPages));
+    info->map = (char *) map;
+    info->mapPages = newMapPages;
+    return RC_OK;
+}
+
+// O_DIRECT transfers need aligned memory
+static bool isPageAligned(const void *memPage) {
+    return ((uintptr_t) memPage % DIRECT_IO_ALIGNMENT) == 0;
+}
+
+// Get size bytes of aligned memory, release it with free()
+static char *allocAligned(size_t size) {
+    void *memory = NULL;
+    if (posix_memalign(&memory, DIRECT_IO_ALIGNMENT, size) != 0)
+        return NULL;
+    return (char *) memory;
+}
+
+// Get an aligned page of memory for the file, release it with free()
+static SM_PageHandle allocAlignedPage(SM_FileMgmtInfo *info) {
+    return (SM_PageHandle) allocAligned(info->pageSize);
+}
+
+// Whether the buffer can be handed to the kernel as it is
+static bool canTransferDirectly(SM_FileMgmtInfo *info, const void *memPage) {
+    return info->mode != SM_MODE_DIRECT || isPageAligned(memPage);
+}
+
+/* Compressed page files */
+
+// Make room in the page map for numPages pages, the new pages are empty
+static RC growPageMap(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    if (!info->compressed || numPages <= info->numPageSlots)
+        return RC_OK;
+
+    SM_BlockNum slots = info->numPageSlots > 0 ? info->numPageSlots : 16;
+    while (slots < numPages)
+        slots *= 2;
+    SM_PageSlot *pageSlots = (SM_PageSlot *) realloc(info->pageSlots, slots * sizeof(SM_PageSlot));
+    if (pageSlots == NULL)
+        return RC_WRITE_FAILED;
+    memset(pageSlots + info->numPageSlots, 0, (slots - info->numPageSlots) * sizeof(SM_PageSlot));
+    info->pageSlots = pageSlots;
+    info->numPageSlots = slots;
+    return RC_OK;
+}
+
+// Load the page map of a compressed file, returns the number of pages it has or -1
+static SM_BlockNum loadPageMap(SM_FileMgmtInfo *info, off_t fileSize) {
+    char name[PATH_MAX];
+    sidecarFileName(info->fileName, ".map", name, sizeof(name));
+    info->mapFd = open(name, O_RDWR | O_CREAT, 0644);
+    struct stat fileInfo;
+    if (info->mapFd < 0 || fstat(info->mapFd, &fileInfo) != 0)
+        return -1;
+
+    SM_BlockNum numPages = fileInfo.st_size / sizeof(SM_PageSlot);
+    size_t size = (size_t) numPages * sizeof(SM_PageSlot);
+    if (growPageMap(info, numPages) != RC_OK || (size > 0 && pread(info->mapFd, info->pageSlots, size, 0) != (ssize_t) size))
+        return -1;
+    info->dataEnd = fileSize > info->headerSize ? fileSize : info->headerSize;
+    return numPages;
+}
+
+// Read a compressed page and decompress it into memPage
+static RC readCompressedPage(SM_FileMgmtInfo *info, SM_BlockNum pageNum, SM_PageHandle memPage) {
+    SM_PageSlot *slot = &info->pageSlots[pageNum];
+
+    // Empty pages take no space at all
+    if (slot->length == 0) {
+        memset(memPage, 0, info->pageSize);
+        return verifyChecksums(info, pageNum, 1, &memPage);
+    }
+
+    // A page that did not compress is read as it is
+    bool stored = slot->length == (uint32_t) info->pageSize;
+    char *buffer = stored ? memPage : (char *) malloc(slot->length);
+    if (buffer == NULL)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    RC rc = RC_OK;
+    if (pread(info->fd, buffer, slot->length, slot->offset) != (ssize_t) slot->length)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    else if (!stored && lzDecompress(buffer, slot->length, memPage, info->pageSize) != info->pageSize)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    if (!stored)
+        free(buffer);
+    return rc == RC_OK ? verifyChecksums(info, pageNum, 1, &memPage) : rc;
+}
+
+// Compress a page and store it, in its old slot when it still fits or in a new one at the end of the file
+static RC writeCompressedPage(SM_FileMgmtInfo *info, SM_BlockNum pageNum, SM_PageHandle memPage) {
+    SM_PageSlot *slot = &info->pageSlots[pageNum];
+
+    // A page of zeros is only an entry in the map
+    bool empty = true;
+    for (int i = 0; i < info->pageSize && empty; i++)
+        empty = memPage[i] == 0;
+
+    char *buffer = (char *) malloc(info->pageSize);
+    if (buffer == NULL)
+        return RC_WRITE_FAILED;
+    size_t length = empty ? 0 : lzCompress(memPage, info->pageSize, buffer, info->pageSize - 1);
+    char *data = buffer;
+    if (!empty && length == 0) {
+        length = info->pageSize;    // Not worth compressing
+        data = memPage;
+    }
+
+    // A page outgrowing its slot moves to the end of the data. The map only learns about the new
+    // place once the page is there, a failed write leaves it pointing to the old one.
+    SM_PageSlot written = *slot;
+    bool moved = length > written.capacity;
+    if (moved) {
+        written.offset = info->dataEnd;
+        written.capacity = ((length + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT) * SLOT_ALIGNMENT;
+    }
+    written.length = length;
+
+    RC rc = RC_OK;
+    if (length > 0 && pwrite(info->fd, data, length, written.offset) != (ssize_t) length)
+        rc = RC_WRITE_FAILED;
+    free(buffer);
+    if (rc != RC_OK)
+        return rc;
+    if (moved)
+        info->dataEnd += written.capacity;
+    *slot = written;
+
+    // The map entry goes out after the page it points to
+    if (pwrite(info->mapFd, slot, sizeof(SM_PageSlot), (off_t) pageNum * sizeof(SM_PageSlot)) != sizeof(SM_PageSlot))
+        return RC_WRITE_FAILED;
+    return recordChecksums(info, pageNum, 1, &memPage);
+}
+
+/* Free page bitmap */
+
+#define FREE_MAP_WORD_BITS 64
+
+// Load the free page bitmap of a file if it ever had a page freed
+static RC loadFreeMap(SM_FileMgmtInfo *info) {
+    char name[PATH_MAX];
+    sidecarFileName(info->fileName, ".fsm", name, sizeof(name));
+    info->freeMapFd = open(name, O_RDWR);
+    if (info->freeMapFd < 0)
+        return RC_OK;
+
+    struct stat fileInfo;
+    if (fstat(info->freeMapFd, &fileInfo) != 0)
+        return RC_FILE_NOT_FOUND;
+    info->freeMapWords = fileInfo.st_size / sizeof(uint64_t);
+    info->freeMap = (uint64_t *) calloc(info->freeMapWords > 0 ? info->freeMapWords : 1, sizeof(uint64_t));
+    size_t size = (size_t) info->freeMapWords * sizeof(uint64_t);
+    if (info->freeMap == NULL || (size > 0 && pread(info->freeMapFd, info->freeMap, size, 0) != (ssize_t) size))
+        return RC_FILE_NOT_FOUND;
+    return RC_OK;
+}
+
+// Whether the bitmap marks a page as free
+static bool pageIsFree(SM_FileMgmtInfo *info, SM_BlockNum pageNum) {
+    SM_BlockNum word = pageNum / FREE_MAP_WORD_BITS;
+    return word < info->freeMapWords && (info->freeMap[word] >> (pageNum % FREE_MAP_WORD_BITS) & 1);
+}
+
+// Mark a page free or in use, in memory and in the bitmap file
+static RC setPageFree(SM_FileMgmtInfo *info, SM_BlockNum pageNum, bool isFree) {
+    SM_BlockNum word = pageNum / FREE_MAP_WORD_BITS;
+
+    if (info->freeMapFd < 0) {
+        char name[PATH_MAX];
+        sidecarFileName(info->fileName, ".fsm", name, sizeof(name));
+        info->freeMapFd = open(name, O_RDWR | O_CREAT, 0644);
+        if (info->freeMapFd < 0)
+            return RC_WRITE_FAILED;
+    }
+    if (word >= info->freeMapWords) {
+        SM_BlockNum words = info->freeMapWords > 0 ? info->freeMapWords : 1;
+        while (words <= word)
+            words *= 2;
+        uint64_t *freeMap = (uint64_t *) realloc(info->freeMap, words * sizeof(uint64_t));
+        if (freeMap == NULL)
+            return RC_WRITE_FAILED;
+        memset(freeMap + info->freeMapWords, 0, (words - info->freeMapWords) * sizeof(uint64_t));
+        info->freeMap = freeMap;
+        info->freeMapWords = words;
+    }
+
+    uint64_t bit = (uint64_t) 1 << (pageNum % FREE_MAP_WORD_BITS);
+    if (isFree) {
+        info->freeMap[word] |= bit;
+        if (word < info->firstFreeWord)
+            info->firstFreeWord = word;
+    } else {
+        info->freeMap[word] &= ~bit;
+    }
+
+    if (pwrite(info->freeMapFd, &info->freeMap[word], sizeof(uint64_t), (off_t) word * sizeof(uint64_t)) != sizeof(uint64_t))
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+// Read exactly one page at the given page position, retrying on short reads
+static RC readPageAt(SM_FileMgmtInfo *info, SM_BlockNum pageNum, SM_PageHandle memPage) {
+    off_t offset;
+    size_t done = 0;
+
+    if (info->compressed)
+        return readCompressedPage(info, pageNum, memPage);
+
+    if (info->mode == SM_MODE_MMAP) {
+        memcpy(memPage, mappedPage(info, pageNum), info->pageSize);
+        return verifyChecksums(info, pageNum, 1, &memPage);
+    }
+
+    // Unaligned memory on a direct handle goes through an aligned bounce page
+    if (!canTransferDirectly(info, memPage)) {
+        SM_PageHandle bounce = allocAlignedPage(info);
+        if (bounce == NULL)
+            return RC_READ_NON_EXISTING_PAGE;
+        RC rc = readPageAt(info, pageNum, bounce);
+        if (rc == RC_OK)
+            memcpy(memPage, bounce, info->pageSize);
+        free(bounce);
+        return rc;
+    }
+
+    int fd = pageLocation(info, pageNum, false, &offset);
+    if (fd < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    while (done < (size_t) info->pageSize) {
+        ssize_t n = pread(fd, memPage + done, info->pageSize - done, offset + done);
+        if (n <= 0)
+            return RC_READ_NON_EXISTING_PAGE;
+        done += n;
+    }
+    return verifyChecksums(info, pageNum, 1, &memPage);
+}
+
+// Write exactly one page at the given page position, retrying on short writes
+static RC writePageAt(SM_FileMgmtInfo *info, SM_BlockNum pageNum, SM_PageHandle memPage) {
+    off_t offset;
+    size_t done = 0;
+
+    if (info->compressed)
+        return writeCompressedPage(info, pageNum, memPage);
+
+    if (info->mode == SM_MODE_MMAP) {
+        memcpy(mappedPage(info, pageNum), memPage, info->pageSize);
+        return recordChecksums(info, pageNum, 1, &memPage);
+    }
+
+    // Unaligned memory on a direct handle goes through an aligned bounce page
+    if (!canTransferDirectly(info, memPage)) {
+        SM_PageHandle bounce = allocAlignedPage(info);
+        if (bounce == NULL)
+            return RC_WRITE_FAILED;
+        memcpy(bounce, memPage, info->pageSize);
+        RC rc = writePageAt(info, pageNum, bounce);
+        free(bounce);
+        return rc;
+    }
+
+    int fd = pageLocation(info, pageNum, false, &offset);
+    if (fd < 0)
+        return RC_WRITE_FAILED;
+
+    while (done < (size_t) info->pageSize) {
+        ssize_t n = pwrite(fd, memPage + done, info->pageSize - done, offset + done);
+        if (n <= 0)
+            return RC_WRITE_FAILED;
+        done += n;
+    }
+    return recordChecksums(info, pageNum, 1, &memPage);
+}
+
+/* Read-ahead */
+
+#define SEQUENTIAL_READS 2  // Reads continuing the one before until the reads count as a scan
+#define DROP_BEHIND_PAGES 32    // Pages a scan under the sequential hint reads between drops of what it read
+
+// Have the kernel start reading numPages pages from startPage into the page cache in the background
+static void prefetchPages(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    if (info->mode == SM_MODE_MMAP) {
+        // madvise wants an address on a page boundary of the system
+        uintptr_t start = (uintptr_t) mappedPage(info, startPage);
+        uintptr_t aligned = start & ~((uintptr_t) sysconf(_SC_PAGESIZE) - 1);
+        madvise((void *) aligned, (size_t) numPages * info->pageSize + (start - aligned), MADV_WILLNEED);
+        return;
+    }
+
+    while (numPages > 0) {
+        SM_BlockNum count = pagesInSegment(info, startPage, numPages);
+        off_t offset;
+        int fd = pageLocation(info, startPage, false, &offset);
+        if (fd < 0)
+            return;
+        posix_fadvise(fd, offset, (off_t) count * info->pageSize, POSIX_FADV_WILLNEED);
+        startPage += count;
+        numPages -= count;
+    }
+}
+
+// Have the kernel drop numPages pages from startPage from the page cache. It only drops whole folios,
+// a large folio reaching out of the range stays. Must hold the handle's lock shared.
+static void uncachePages(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    if (info->compressed) {
+        for (SM_BlockNum page = startPage; page < startPage + numPages; page++)
+            if (info->pageSlots[page].length > 0)
+                posix_fadvise(info->fd, info->pageSlots[page].offset, info->pageSlots[page].length, POSIX_FADV_DONTNEED);
+        return;
+    }
+    if (info->mode == SM_MODE_DIRECT || numPages <= 0)
+        return;
+
+    // Mapped pages are only dropped once the mapping lets go of them
+    if (info->mode == SM_MODE_MMAP) {
+        uintptr_t start = (uintptr_t) mappedPage(info, startPage);
+        uintptr_t aligned = start & ~((uintptr_t) sysconf(_SC_PAGESIZE) - 1);
+        madvise((void *) aligned, (size_t) numPages * info->pageSize + (start - aligned), MADV_DONTNEED);
+    }
+    while (numPages > 0) {
+        SM_BlockNum count = pagesInSegment(info, startPage, numPages);
+        off_t offset;
+        int fd = pageLocation(info, startPage, false, &offset);
+        if (fd >= 0)
+            posix_fadvise(fd, offset, (off_t) count * info->pageSize, POSIX_FADV_DONTNEED);
+        startPage += count;
+        numPages -= count;
+    }
+}
+
+// Follow the reads of a handle: once they read the file in order, keep the pages of the read-ahead
+// window ahead of them on their way into the page cache. Read-ahead is issued half a window at a time
+// at least. Direct handles bypass the page cache and compressed pages have no fixed place, both go without.
+// Under the sequential hint the pages behind the scan are dropped from the page cache DROP_BEHIND_PAGES
+// at a time. Must hold the handle's lock shared.
+static void readAhead(SM_FileMgmtInfo *info, SM_BlockNum startPage, int numPages, SM_BlockNum totalNumPages) {
+    if ((info->readAheadPages == 0 && !info->sequentialHint) || info->compressed || info->mode == SM_MODE_DIRECT)
+        return;
+    // Threads reading the handle at the same time are no scan, rather skip than wait
+    if (pthread_mutex_trylock(&info->readAheadLock) != 0)
+        return;
+
+    SM_BlockNum end = startPage + numPages;
+    if (startPage == info->nextSequentialPage) {
+        info->sequentialReads++;
+    } else {
+        info->sequentialReads = 0;
+        info->prefetchedEnd = 0;
+        info->scanStart = startPage;
+        info->droppedEnd = startPage;
+    }
+    info->nextSequentialPage = end;
+
+    if (info->readAheadPages > 0 && info->sequentialReads >= SEQUENTIAL_READS && info->prefetchedEnd - end < info->readAheadPages / 2) {
+        SM_BlockNum from = info->prefetchedEnd > end ? info->prefetchedEnd : end;
+        SM_BlockNum to = end + info->readAheadPages < totalNumPages ? end + info->readAheadPages : totalNumPages;
+        if (to > from) {
+            prefetchPages(info, from, to - from);
+            info->prefetchedEnd = to;
+        }
+    }
+
+    // Each batch dropped overlaps the one before, for the folios reaching into both
+    if (info->sequentialHint && end - info->droppedEnd >= DROP_BEHIND_PAGES) {
+        SM_BlockNum from = info->droppedEnd - DROP_BEHIND_PAGES > info->scanStart ? info->droppedEnd - DROP_BEHIND_PAGES : info->scanStart;
+        uncachePages(info, from, end - from);
+        info->droppedEnd = end;
+    }
+    pthread_mutex_unlock(&info->readAheadLock);
+}
+
+// Move numPages pages of pageSize bytes between a descriptor, starting at the given offset, and the given
+// buffers. One preadv/pwritev covers the whole run (split only at IOV_MAX), short transfers are resumed.
+static RC transferPages(int fd, off_t startOffset, int numPages, int pageSize, SM_PageHandle *memPages, bool isWrite) {
+    struct iovec iov[IOV_MAX];
+    int page = 0;           // First page of the run not completely transferred yet
+    size_t pageDone = 0;    // Bytes of that page already transferred
+
+    while (page < numPages) {
+        int count = 0;
+        for (int i = page; i < numPages && count < IOV_MAX; i++, count++) {
+            size_t skip = (i == page) ? pageDone : 0;
+            iov[count].iov_base = memPages[i] + skip;
+            iov[count].iov_len = pageSize - skip;
+        }
+
+        off_t offset = startOffset + (off_t) page * pageSize + pageDone;
+        ssize_t n = isWrite ? pwritev(fd, iov, count, offset) : preadv(fd, iov, count, offset);
+        if (n <= 0)
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+        // Advance over the pages the call finished and remember how far it got into the next one
+        size_t total = pageDone + n;
+        page += total / pageSize;
+        pageDone = total % pageSize;
+    }
+    return RC_OK;
+}
+
+// Move numPages pages between the file, starting at startPage, and the given buffers.
+// A run crossing segment boundaries is transferred one segment at a time.
+static RC transferRun(SM_FileMgmtInfo *info, SM_BlockNum startPage, int numPages, SM_PageHandle *memPages, bool isWrite) {
+    bool pageByPage = (info->mode == SM_MODE_MMAP || info->compressed);
+    for (int i = 0; i < numPages && !pageByPage; i++)
+        pageByPage = !canTransferDirectly(info, memPages[i]);
+
+    if (pageByPage) {
+        for (int i = 0; i < numPages; i++) {
+            RC rc = isWrite ? writePageAt(info, startPage + i, memPages[i]) : readPageAt(info, startPage + i, memPages[i]);
+            if (rc != RC_OK)
+                return rc;
+        }
+        return RC_OK;
+    }
+
+    while (numPages > 0) {
+        int count = (int) pagesInSegment(info, startPage, numPages);
+        off_t offset;
+        int fd = pageLocation(info, startPage, false, &offset);
+        if (fd < 0)
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+        RC rc = transferPages(fd, offset, count, info->pageSize, memPages, isWrite);
+        if (rc == RC_OK)
+            rc = isWrite ? recordChecksums(info, startPage, count, memPages) : verifyChecksums(info, startPage, count, memPages);
+        if (rc != RC_OK)
+            return rc;
+
+        startPage += count;
+        memPages += count;
+        numPages -= count;
+    }
+    return RC_OK;
+}
+
+// Reserve disk space for at least numPages pages without changing the file size, a whole
+// extent at a time so a growing file is allocated in few large contiguous pieces
+static void reserveExtent(SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    if (numPages <= info->allocatedPages)
+        return;
+
+    SM_BlockNum extent = info->extentPages;
+    if (info->geometric && info->allocatedPages > extent)
+        extent = info->allocatedPages;
+    SM_BlockNum target = ((numPages + extent - 1) / extent) * extent;
+
+    // Never reserve past the segment of the last page, the next segment is created once it is reached
+    if (info->segmentPages > 0) {
+        SM_BlockNum segmentEnd = ((numPages + info->segmentPages - 1) / info->segmentPages) * info->segmentPages;
+        if (target > segmentEnd)
+            target = segmentEnd;
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    while (info->allocatedPages < target) {
+        SM_BlockNum count = pagesInSegment(info, info->allocatedPages, target - info->allocatedPages);
+        off_t offset;
+        int fd = pageLocation(info, info->allocatedPages, true, &offset);
+        if (fd < 0 || fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, (off_t) count * info->pageSize) != 0)
+            return;     // Not supported by the file system, the file just grows without reservation
+        info->allocatedPages += count;
+    }
+#endif
+    info->allocatedPages = target;
+}
+
+// Grow the file from oldPages to numPages zero filled pages. A single ftruncate per segment extends
+// the file no matter how many pages are added, the new pages read back as zeros without ever being written.
+static RC growFile(SM_FileMgmtInfo *info, SM_BlockNum oldPages, SM_BlockNum numPages) {
+    if (growChecksums(info, numPages) != RC_OK)
+        return RC_WRITE_FAILED;
+
+    // New pages of a compressed file are empty map entries, they take no space until written
+    if (info->compressed) {
+        if (growPageMap(info, numPages) != RC_OK || ftruncate(info->mapFd, (off_t) numPages * sizeof(SM_PageSlot)) != 0)
+            return RC_WRITE_FAILED;
+        return RC_OK;
+    }
+
+    reserveExtent(info, numPages);
+
+    for (SM_BlockNum page = oldPages; page < numPages; ) {
+        SM_BlockNum count = pagesInSegment(info, page, numPages - page);
+        off_t offset;
+        int fd = pageLocation(info, page, true, &offset);
+        if (fd < 0 || ftruncate(fd, offset + (off_t) count * info->pageSize) != 0)
+            return RC_WRITE_FAILED;
+        page += count;
+    }
+
+    // Extend the mapping after the file so the newly mapped pages are backed by it
+    if (info->mode == SM_MODE_MMAP)
+        return mapPages(info, numPages);
+    return RC_OK;
+}
+
+// Grow the file of a handle to numPages pages, nothing to do if it has that many already.
+// The caller holds the handle's lock exclusively whenever the file does grow.
+static RC growHandle(SM_FileHandle *fHandle, SM_FileMgmtInfo *info, SM_BlockNum numPages) {
+    if (numPages <= fHandle->totalNumPages)
+        return RC_OK;
+
+    RC rc = growFile(info, fHandle->totalNumPages, numPages);
+    if (rc != RC_OK)
+        return rc;
+    fHandle->totalNumPages = numPages;
+    return RC_OK;
+}
+
+// Flush everything written through a handle to stable storage: the pages of every segment it opened,
+// then the checksums, page map and free page bitmap describing them
+static RC syncFiles(SM_FileMgmtInfo *info) {
+    pthread_rwlock_rdlock(&info->lock);
+    bool synced = true;
+
+    // Mapped pages are written back by msync, the file descriptor only covers what went through it
+    if (info->map != NULL)
+        synced = msync(info->map, mapSize(info, info->mapPages), MS_SYNC) == 0;
+    synced = fdatasync(info->fd) == 0 && synced;
+
+    pthread_mutex_lock(&info->segmentLock);
+    for (int i = 0; i < info->numSegmentFds; i++)
+        if (info->segmentFds[i] >= 0 && fdatasync(info->segmentFds[i]) != 0)
+            synced = false;
+    pthread_mutex_unlock(&info->segmentLock);
+
+    // Pages first, what describes them after
+    if (info->checksumFd >= 0 && fdatasync(info->checksumFd) != 0)
+        synced = false;
+    if (info->mapFd >= 0 && fdatasync(info->mapFd) != 0)
+        synced = false;
+    if (info->freeMapFd >= 0 && fdatasync(info->freeMapFd) != 0)
+        synced = false;
+
+    pthread_rwlock_unlock(&info->lock);
+    return synced ? RC_OK : RC_WRITE_FAILED;
+}
+
+// Read the header of a page file, false if the file has none
+static bool readHeader(int fd, SM_FileHeader *header) {
+    char *buffer = allocAligned(SM_HEADER_SIZE);    // The descriptor can be a direct one
+    if (buffer == NULL)
+        return false;
+
+    bool found = pread(fd, buffer, SM_HEADER_SIZE, 0) == SM_HEADER_SIZE && memcmp(buffer, SM_FILE_MAGIC, sizeof(header->magic)) == 0;
+    if (found)
+        memcpy(header, buffer, sizeof(SM_FileHeader));
+    free(buffer);
+    return found;
+}
+
+// Write the header describing the file behind info
+static RC writeHeader(SM_FileMgmtInfo *info) {
+    char *buffer = allocAligned(SM_HEADER_SIZE);
+    if (buffer == NULL)
+        return RC_WRITE_FAILED;
+
+    SM_FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    header.version = SM_FILE_VERSION;
+    header.pageSize = info->pageSize;
+    header.segmentPages = info->segmentPages;
+    header.flags = (info->checksums ? SM_HEADER_CHECKSUMS : 0) | (info->compressed ? SM_HEADER_COMPRESSED : 0);
+
+    memset(buffer, 0, SM_HEADER_SIZE);
+    memcpy(buffer, &header, sizeof(header));
+    RC rc = pwrite(info->fd, buffer, SM_HEADER_SIZE, 0) == SM_HEADER_SIZE ? RC_OK : RC_WRITE_FAILED;
+    free(buffer);
+    return rc;
+}
+
+// Page sizes are powers of two from SM_MIN_PAGE_SIZE to SM_MAX_PAGE_SIZE
+static bool isValidPageSize(int pageSize) {
+    return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// Drop the mapping, close every descriptor of an open file and free its bookkeeping.
+// Returns 0 if all descriptors closed fine.
+static int releaseMgmtInfo(SM_FileMgmtInfo *info) {
+    // The kernel writes the dirty mapped pages back on its own
+    if (info->map != NULL)
+        munmap(info->map, mapSize(info, info->mapPages));
+
+    // The descriptors of the file and its segments go back to the cache
+    int fileClosed = releaseFd(info->fd);
+    for (int i = 0; i < info->numSegmentFds; i++)
+        if (info->segmentFds[i] >= 0 && releaseFd(info->segmentFds[i]) != 0)
+            fileClosed = -1;
+    if (info->checksumFd >= 0 && close(info->checksumFd) != 0)
+        fileClosed = -1;
+    if (info->mapFd >= 0 && close(info->mapFd) != 0)
+        fileClosed = -1;
+    if (info->freeMapFd >= 0 && close(info->freeMapFd) != 0)
+        fileClosed = -1;
+
+    free(info->segmentFds);
+    free(info->failedSyncs);
+    free(info->pageChecksums);
+    free(info->pageSlots);
+    free(info->freeMap);
+    free(info->fileName);
+    pthread_cond_destroy(&info->syncDone);
+    pthread_mutex_destroy(&info->syncLock);
+    pthread_mutex_destroy(&info->readAheadLock);
+    pthread_mutex_destroy(&info->segmentLock);
+    pthread_rwlock_destroy(&info->lock);
+    free(info);
+    return fileClosed;
+}
 
 /* MANIPULATING PAGE FILES */
 /***************************/
 
-FILE *filePointer;
+// Initialize any necessary variables or data structures
+void initStorageManager(void) {
+    // All state lives in the file handles and the descriptor cache, which starts out empty
+}
+
+// Create a new page file with one page of PAGE_SIZE bytes
+RC createPageFile(char *fileName) {
+    return createPageFileOptions(fileName, NULL);
+}
+
+// Create a new page file with one empty page, laid out as the options say (NULL for the defaults)
+static RC fileCreatePageFile(char *fileName, const SM_FileOptions *options) {
+    int pageSize = (options != NULL && options->pageSize != 0) ? options->pageSize : PAGE_SIZE;
+    SM_BlockNum segmentPages = (options != NULL) ? options->segmentPages : 0;
+    bool compressed = options != NULL && options->compressed;
+    // A compressed file has a single page map, it cannot be split in segments
+    if (!isValidPageSize(pageSize) || segmentPages < 0 || (compressed && segmentPages > 0))
+        return RC_WRITE_FAILED;
+
+    // Descriptors cached for an earlier file of the same name would lead to its segments
+    forgetFds(fileName);
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return RC_FILE_NOT_FOUND; // If unable to open file return File not Found
+
+    // Segments, checksums, free pages and page maps left over from an earlier file of the same name would be taken for this one's
+    char name[PATH_MAX];
+    removeSegments(fileName);
+    sidecarFileName(fileName, ".crc", name, sizeof(name));
+    remove(name);
+    sidecarFileName(fileName, ".fsm", name, sizeof(name));
+    remove(name);
+    sidecarFileName(fileName, ".map", name, sizeof(name));
+    remove(name);
+
+    // But if successful... write the header and the first (empty) page
+    SM_FileMgmtInfo info;
+    initMgmtInfo(&info, fd, SM_MODE_PREAD, 0);
+    info.pageSize = pageSize;
+    info.segmentPages = segmentPages;
+    info.checksums = options != NULL && options->checksums;
+    info.compressed = compressed;
+    info.extentPages = 1;   // Nothing is reserved ahead for a file that may stay this small
+    if (compressed)
+        info.mapFd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    RC rc = (compressed && info.mapFd < 0) ? RC_FILE_NOT_FOUND : writeHeader(&info);
+    if (rc == RC_OK)
+        rc = growFile(&info, 0, 1);
+
+    // Clean up, the checksum file is created on first open
+    free(info.pageChecksums);
+    free(info.pageSlots);
+    pthread_cond_destroy(&info.syncDone);
+    pthread_mutex_destroy(&info.syncLock);
+    pthread_mutex_destroy(&info.readAheadLock);
+    pthread_mutex_destroy(&info.segmentLock);
+    pthread_rwlock_destroy(&info.lock);
+    if (info.mapFd >= 0)
+        close(info.mapFd);
+    close(fd);          // Close connection
+    return rc;
+}
+
+// Open an existing page file
+RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
+    return openPageFileMode(fileName, fHandle, SM_MODE_PREAD);
+}
+
+// Open an existing page file choosing how its blocks are accessed
+RC openPageFileMode(char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode) {
+    return openPageFileSegmented(fileName, fHandle, mode, 0);
+}
+
+// Open a page file stored as segment files of segmentPages pages each: the file itself holds
+// the first segment and <fileName>.1, <fileName>.2, ... the following ones. The segment size is
+// recorded in the header, with segmentPages 0 the file keeps the one it was written with.
+static RC fileOpenPageFile(char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode, SM_BlockNum segmentPages) {
+    // Segments cannot share one mapping
+    if (segmentPages < 0 || (segmentPages > 0 && mode == SM_MODE_MMAP))
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Get a read+write descriptor of the file, shared with other handles of it and kept until closePageFile.
+    // A direct handle bypasses the OS page cache, the buffer pool is the only cache.
+    int fd = acquireFd(fileName, mode == SM_MODE_DIRECT, false);
+    if (fd < 0)
+        return RC_FILE_NOT_FOUND;
+
+    // Get the file size to know how many pages it holds
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) < 0) {
+        releaseFd(fd);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // The header tells the page size, a file without one has PAGE_SIZE pages from its first byte on
+    SM_FileHeader header;
+    bool hasHeader = readHeader(fd, &header);
+    int pageSize = hasHeader ? header.pageSize : PAGE_SIZE;
+    off_t headerSize = hasHeader ? SM_HEADER_SIZE : 0;
+    SM_BlockNum storedSegmentPages = hasHeader ? header.segmentPages : 0;
+    bool compressed = hasHeader && (header.flags & SM_HEADER_COMPRESSED) != 0;
+    off_t fileSize = fileInfo.st_size;
+    SM_BlockNum firstPages = fileSize > headerSize ? (fileSize - headerSize) / pageSize : 0;
+
+    // A file keeps its segment size, one that is not segmented yet can only become so while it fits in a segment.
+    // Compressed pages have no fixed place, they can only be read and written one by one.
+    bool badSegments = storedSegmentPages > 0 ? (segmentPages > 0 && segmentPages != storedSegmentPages) : (segmentPages > 0 && firstPages > segmentPages);
+    bool badCompression = compressed && (mode != SM_MODE_PREAD || segmentPages > 0);
+    if (!isValidPageSize(pageSize) || badSegments || badCompression || (storedSegmentPages > 0 && mode == SM_MODE_MMAP)) {
+        releaseFd(fd);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    bool recordSegments = hasHeader && storedSegmentPages == 0 && segmentPages > 0;
+    if (segmentPages == 0)
+        segmentPages = storedSegmentPages;
+
+    // Count the pages of the following segments, they are only opened once a page of theirs is used
+    SM_BlockNum totalNumPages = firstPages;
+    char name[PATH_MAX];
+    for (SM_BlockNum segment = 1; segmentPages > 0; segment++) {
+        segmentFileName(fileName, segment, name, sizeof(name));
+        if (stat(name, &fileInfo) != 0)
+            break;
+        totalNumPages += fileInfo.st_size / pageSize;
+    }
+
+    SM_FileMgmtInfo *info = (SM_FileMgmtInfo *) malloc(sizeof(SM_FileMgmtInfo));
+    char *nameCopy = strdup(fileName);
+    if (info == NULL || nameCopy == NULL) {
+        free(info);
+        free(nameCopy);
+        releaseFd(fd);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    initMgmtInfo(info, fd, mode, totalNumPages);
+    info->pageSize = pageSize;
+    info->headerSize = headerSize;
+    info->fileName = nameCopy;
+    info->segmentPages = segmentPages;
+    info->checksums = hasHeader && (header.flags & SM_HEADER_CHECKSUMS) != 0;
+    info->verifyChecksums = info->checksums;
+    info->compressed = compressed;
+
+    // Map the whole file up front, reads and writes are plain copies from then on.
+    // A file segmented from now on remembers it. A compressed file has as many pages as its page map.
+    RC rc = RC_OK;
+    if (compressed && (totalNumPages = loadPageMap(info, fileSize)) < 0)
+        rc = RC_FILE_NOT_FOUND;
+    if (rc == RC_OK && info->checksums)
+        rc = loadChecksums(info, totalNumPages);
+    if (rc == RC_OK)
+        rc = loadFreeMap(info);
+    if (rc == RC_OK && mode == SM_MODE_MMAP)
+        rc = mapPages(info, totalNumPages);
+    else if (rc == RC_OK && recordSegments)
+        rc = writeHeader(info);
+    if (rc != RC_OK) {
+        releaseMgmtInfo(info);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // Set file handle properties
+    fHandle->backend = &fileBackend;
+    fHandle->fileName = fileName;
+    fHandle->curPagePos = 0;
+    fHandle->totalNumPages = totalNumPages;
+    fHandle->pageSize = pageSize;
+    fHandle->mgmtInfo = info;
+
+    return RC_OK;
+}
+
+
+// Close the page file
+static RC fileClosePageFile(SM_FileHandle *fHandle) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Queued asynchronous requests still point to the handle, they have to be polled first
+    if (__atomic_load_n(&info->pendingRequests, __ATOMIC_ACQUIRE) > 0)
+        return RC_FILE_IN_USE;
+
+    // Release the descriptors and the bookkeeping attached to the handle
+    int fileClosed = releaseMgmtInfo(info);
+    fHandle->mgmtInfo = NULL;
+
+    if (fileClosed != 0)                    // If not closed due to close failing...
+        return RC_FILE_NOT_FOUND;
+    return RC_OK;                           // File successfully closed
+}
+
+// Make every block written before the call durable. Callers syncing the same handle at the same time
+// share one sync: whoever finds no sync running does it for everyone who asked so far, the others wait
+// for it. Callers arriving while it runs are covered by the next one.
+static RC fileSyncPageFile(SM_FileHandle *fHandle) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&info->syncLock);
+    unsigned long long ticket = ++info->syncRequests;
+    bool unrecorded = false;    // A sync this caller did failed and could not be kept for the others
+    while (info->syncedRequests < ticket) {
+        if (info->syncing) {
+            pthread_cond_wait(&info->syncDone, &info->syncLock);
+            continue;
+        }
+
+        // Wait for others to join, only when callers have been coming together lately
+        info->syncing = true;
+        if (info->groupCommitDelay > 0 && info->lastGroupSize > 1) {
+            pthread_mutex_unlock(&info->syncLock);
+            usleep(info->groupCommitDelay);
+            pthread_mutex_lock(&info->syncLock);
+        }
+        unsigned long long covered = info->syncRequests;
+        pthread_mutex_unlock(&info->syncLock);
+
+        RC rc = syncFiles(info);
+
+        pthread_mutex_lock(&info->syncLock);
+        if (rc != RC_OK) {
+            // fdatasync reports an error only once, so it is kept for the tickets of this sync. Callers
+            // can wake up after a later sync succeeded, they must still learn their writes may be lost.
+            SM_FailedSync *failed = (SM_FailedSync *) realloc(info->failedSyncs, (info->numFailedSyncs + 1) * sizeof(SM_FailedSync));
+            if (failed != NULL) {
+                failed[info->numFailedSyncs++] = (SM_FailedSync) { info->syncedRequests, covered, covered - info->syncedRequests };
+                info->failedSyncs = failed;
+            } else {
+                unrecorded = true;
+            }
+        }
+        info->lastGroupSize = covered - info->syncedRequests;
+        info->syncedRequests = covered;
+        info->syncing = false;
+        pthread_cond_broadcast(&info->syncDone);
+    }
+
+    // The sync covering the ticket failed: report it, and forget the sync once all its callers know
+    RC rc = unrecorded ? RC_WRITE_FAILED : RC_OK;
+    for (int i = 0; i < info->numFailedSyncs; i++) {
+        SM_FailedSync *failed = &info->failedSyncs[i];
+        if (ticket > failed->from && ticket <= failed->through) {
+            rc = RC_WRITE_FAILED;
+            if (--failed->unreported == 0)
+                info->failedSyncs[i] = info->failedSyncs[--info->numFailedSyncs];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&info->syncLock);
+    return rc;
+}
+
+//Destroying Page file
+static RC fileDestroyPageFile(char *fileName) {
+    // Deleting the given filename so that it is no longer accessible.
+    forgetFds(fileName);
+    if (remove(fileName) != 0)
+        return RC_FILE_NOT_FOUND;
+    removeSegments(fileName);
+
+    char name[PATH_MAX];
+    sidecarFileName(fileName, ".crc", name, sizeof(name));
+    remove(name);
+    sidecarFileName(fileName, ".fsm", name, sizeof(name));
+    remove(name);
+    sidecarFileName(fileName, ".map", name, sizeof(name));
+    remove(name);
+    return RC_OK;
+}
+
+/* READING BLOCKS FROM DISC */
+/****************************/
+
+// Read a specific block from the file
+static RC fileReadBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Checking if the pageNumber parameter is inside the file, otherwise return respective error code
+    pthread_rwlock_rdlock(&info->lock);
+    if (pageNum >= fHandle->totalNumPages || pageNum < 0) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    // A single positioned read at Page Number x Page Size, no seek and no reopen, other threads read alongside
+    RC rc = readPageAt(info, pageNum, memPage);
+    if (rc == RC_OK)
+        readAhead(info, pageNum, 1, fHandle->totalNumPages);
+    pthread_rwlock_unlock(&info->lock);
+    if (rc != RC_OK)
+        return rc;
+
+    // Setting the current page position to the page we just read
+    setPagePos(fHandle, pageNum);
+    return RC_OK;
+}
+
+// Get the current block position in the file
+SM_BlockNum getBlockPos(SM_FileHandle *fHandle) {
+    return fHandle->curPagePos;
+}
+
+// Read the first block from the file
+RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    return readBlock(0, fHandle, memPage);
+}
+
+// Read the previous block relative to the current page position
+RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    if ((fHandle->curPagePos - 1) < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    else
+        return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
+}
+
+RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    return readBlock(fHandle->curPagePos, fHandle, memPage);
+}
+
+// Read the next block relative to the current page position
+RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    if ((fHandle->curPagePos + 1) >= fHandle->totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+    else
+        return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
+}
+
+// Read the last block in the file
+RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
+
+/* WRITING BLOCKS TO A PAGE FILE */
+/*********************************/
+
+// Write a block at a specific position
+static RC fileWriteBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Writing one page past the end appends it, anything further is an error
+    lockForWrite(fHandle, info, pageNum);
+    if (pageNum > fHandle->totalNumPages || pageNum < 0) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_WRITE_FAILED;
+    }
+
+    // Make room for the appended page first
+    RC rc = growHandle(fHandle, info, pageNum + 1);
+    if (rc == RC_OK)
+        rc = writePageAt(info, pageNum, memPage);
+    pthread_rwlock_unlock(&info->lock);
+    if (rc != RC_OK)
+        return rc;
+
+    // Setting the current page position to the page we just wrote
+    setPagePos(fHandle, pageNum);
+    return RC_OK;
+}
+
+// Write the current block
+RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    return writeBlock(fHandle->curPagePos, fHandle, memPage);
+}
+
+// Turn checking pages against their checksums on reads on or off. Checksums are kept up
+// to date either way, verification can only be turned on for a file created with them.
+RC setChecksumVerification(SM_FileHandle *fHandle, int verify) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL || (verify && !info->checksums))
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_rwlock_wrlock(&info->lock);
+    info->verifyChecksums = verify;
+    pthread_rwlock_unlock(&info->lock);
+    return RC_OK;
+}
+
+// Choose how the file grows: disk space is reserved extentPages pages at a time, or with
+// geometric set as much again as the file already has once that is bigger than an extent
+RC setGrowthPolicy(SM_FileHandle *fHandle, int extentPages, int geometric) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (extentPages <= 0)
+        return RC_WRITE_FAILED;
+
+    pthread_rwlock_wrlock(&info->lock);
+    info->extentPages = extentPages;
+    info->geometric = geometric;
+    pthread_rwlock_unlock(&info->lock);
+    return RC_OK;
+}
+
+// Let the caller syncing for a group wait up to maxDelayMicros for more callers to join its sync,
+// once callers have been syncing the handle at the same time. 0 syncs right away.
+RC setGroupCommitDelay(SM_FileHandle *fHandle, int maxDelayMicros) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (maxDelayMicros < 0)
+        return RC_WRITE_FAILED;
+
+    pthread_mutex_lock(&info->syncLock);
+    info->groupCommitDelay = maxDelayMicros;
+    pthread_mutex_unlock(&info->syncLock);
+    return RC_OK;
+}
+
+// Choose how many pages are read ahead once a handle reads the file in order, 0 turns read-ahead off
+RC setReadAhead(SM_FileHandle *fHandle, int windowPages) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (windowPages < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    pthread_rwlock_wrlock(&info->lock);
+    info->readAheadPages = windowPages;
+    info->prefetchedEnd = 0;
+    pthread_rwlock_unlock(&info->lock);
+    return RC_OK;
+}
+
+// Tell the storage manager and the kernel whether the file is read in order by scans reading it once,
+// like reports. The kernel reads further ahead then, and the pages behind the scan are dropped from
+// the page cache so they do not push out pages used over and over. Turning the hint off drops the rest
+// of the last scan with what was read ahead of it. The advice to the kernel is on the descriptors,
+// which all handles of the file share.
+RC setSequentialHint(SM_FileHandle *fHandle, int sequential) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
 
-// Initialize any necessary variables or data structures
-void initStorageManager(void) {
-    filePointer = NULL;
+    int advice = sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_NORMAL;
+    pthread_rwlock_wrlock(&info->lock);
+    if (info->sequentialHint && !sequential && info->nextSequentialPage >= 0) {
+        SM_BlockNum from = info->droppedEnd - DROP_BEHIND_PAGES > info->scanStart ? info->droppedEnd - DROP_BEHIND_PAGES : info->scanStart;
+        SM_BlockNum to = info->prefetchedEnd > info->nextSequentialPage ? info->prefetchedEnd : info->nextSequentialPage;
+        if (to > fHandle->totalNumPages)
+            to = fHandle->totalNumPages;
+        if (to > from)
+            uncachePages(info, from, to - from);
+        info->droppedEnd = info->nextSequentialPage;
+    }
+    info->sequentialHint = sequential;
+    posix_fadvise(info->fd, 0, 0, advice);
+    pthread_mutex_lock(&info->segmentLock);
+    for (int i = 0; i < info->numSegmentFds; i++)
+        if (info->segmentFds[i] >= 0)
+            posix_fadvise(info->segmentFds[i], 0, 0, advice);
+    pthread_mutex_unlock(&info->segmentLock);
+    pthread_rwlock_unlock(&info->lock);
+    return RC_OK;
 }
 
-// Create a new page file with one page of PAGE_SIZE bytes
-RC createPageFile(char *fileName) {
+// Drop numPages pages from startPage out of the OS page cache, e.g. once a scan reading the file
+// once is past them, so they do not push out pages used over and over. Pages written but not yet
+// on disk stay until they are. Direct handles keep nothing in the page cache to begin with.
+RC dropPageCache(SM_FileHandle *fHandle, SM_BlockNum startPage, SM_BlockNum numPages) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
 
-    filePointer = fopen(fileName, "w+"); // w+ used to open file for read/write
-    if (filePointer == NULL)
-        return RC_FILE_NOT_FOUND; // If unable to open file, filePointer will be NULL and return File not Found
+    pthread_rwlock_rdlock(&info->lock);
+    if (startPage < 0 || numPages < 0 || startPage + numPages > fHandle->totalNumPages) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    uncachePages(info, startPage, numPages);
+    pthread_rwlock_unlock(&info->lock);
+    return RC_OK;
+}
 
-    // But if successful...
-	SM_PageHandle emptyPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-    if(fwrite(emptyPage, sizeof(char), PAGE_SIZE, filePointer) < PAGE_SIZE)
-		printf("Failed \n");
-	else
-		printf("Succeeded");
-	
-    // Clean up
-    fclose(filePointer);                                    // Close connection
-    free(emptyPage);                                            // Free block to avoid memory leaks
+// Keep at most maxIdle descriptors of files no handle uses open, 0 closes each with its last handle
+RC setDescriptorCacheSize(int maxIdle) {
+    if (maxIdle < 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&fdCacheLock);
+    fdCacheSize = maxIdle;
+    evictIdleFds(fdCacheSize);
+    pthread_mutex_unlock(&fdCacheLock);
     return RC_OK;
 }
 
-// Open an existing page file
-RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
-    // Open the file in read+write mode
-    FILE *filePointer = fopen(fileName, "r+");
-    if (filePointer == NULL) {
-        return RC_FILE_NOT_FOUND;
+/* FREE PAGES */
+/**************/
+
+// Get a page to store new data in: the first free page of the file, emptied, or a
+// new page appended at the end when none is free. The page number goes to *pageNum.
+RC allocatePage(SM_FileHandle *fHandle, SM_BlockNum *pageNum) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL || pageNum == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_rwlock_wrlock(&info->lock);
+    RC rc = RC_OK;
+
+    // Skip 64 used pages at a time, the lowest set bit of a word is its first free page
+    for (SM_BlockNum word = info->firstFreeWord; word < info->freeMapWords; word++) {
+        if (info->freeMap[word] == 0)
+            continue;
+        info->firstFreeWord = word;
+        SM_BlockNum page = word * FREE_MAP_WORD_BITS + __builtin_ctzll(info->freeMap[word]);
+
+        // A reused page starts out empty like an appended one
+        SM_PageHandle emptyPage = allocAlignedPage(info);
+        if (emptyPage != NULL) {
+            memset(emptyPage, 0, info->pageSize);
+            rc = writePageAt(info, page, emptyPage);
+            free(emptyPage);
+        } else {
+            rc = RC_WRITE_FAILED;
+        }
+        if (rc == RC_OK)
+            rc = setPageFree(info, page, false);
+        if (rc == RC_OK)
+            *pageNum = page;
+        pthread_rwlock_unlock(&info->lock);
+        return rc;
     }
+    info->firstFreeWord = info->freeMapWords;
 
-    // Set file handle properties
-    fHandle->fileName = fileName;
-    fHandle->curPagePos = 0;
+    rc = growHandle(fHandle, info, fHandle->totalNumPages + 1);
+    if (rc == RC_OK)
+        *pageNum = fHandle->totalNumPages - 1;
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
 
-    // Move to the end of the file to determine its size
-    if (fseek(filePointer, 0, SEEK_END) != 0) {
-        fclose(filePointer);
-        return RC_FILE_NOT_FOUND;
+// Give a page back, allocatePage hands it out again. Its content stays readable until then.
+RC freePage(SM_FileHandle *fHandle, SM_BlockNum pageNum) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_rwlock_wrlock(&info->lock);
+    RC rc;
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    else if (pageIsFree(info, pageNum))
+        rc = RC_WRITE_FAILED;       // Freed twice
+    else
+        rc = setPageFree(info, pageNum, true);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
+
+// Whether a page is free, scans can skip such pages without reading them
+int isPageFree(SM_FileHandle *fHandle, SM_BlockNum pageNum) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL || pageNum < 0)
+        return false;
+
+    pthread_rwlock_rdlock(&info->lock);
+    bool isFree = pageIsFree(info, pageNum);
+    pthread_rwlock_unlock(&info->lock);
+    return isFree;
+}
+
+/* RELEASING DISK SPACE */
+/*************************/
+
+// Give the disk space of numPages pages from startPage back to the file system. The pages stay
+// in the file and read back as zeros. Where holes cannot be punched the pages are zeroed instead.
+static RC punchPages(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    while (numPages > 0) {
+        SM_BlockNum count = pagesInSegment(info, startPage, numPages);
+        off_t offset;
+        int fd = pageLocation(info, startPage, false, &offset);
+        if (fd < 0)
+            return RC_WRITE_FAILED;
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+        bool punched = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, (off_t) count * info->pageSize) == 0;
+#else
+        bool punched = false;
+#endif
+        if (!punched) {
+            SM_PageHandle emptyPage = allocAlignedPage(info);
+            if (emptyPage == NULL)
+                return RC_WRITE_FAILED;
+            memset(emptyPage, 0, info->pageSize);
+            RC rc = RC_OK;
+            for (SM_BlockNum i = 0; i < count && rc == RC_OK; i++)
+                rc = writePageAt(info, startPage + i, emptyPage);
+            free(emptyPage);
+            if (rc != RC_OK)
+                return rc;
+        }
+        startPage += count;
+        numPages -= count;
     }
+    return RC_OK;
+}
 
-    // Get the file size using ftell
-    long fileSize = ftell(filePointer);
-    if (fileSize < 0) {
-        fclose(filePointer);
-        return RC_FILE_NOT_FOUND;
+// Release the slots of numPages compressed pages from startPage, they become empty pages
+static RC releaseSlots(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    for (SM_BlockNum page = startPage; page < startPage + numPages; page++) {
+        SM_PageSlot *slot = &info->pageSlots[page];
+        if (slot->capacity == 0)
+            continue;
+#ifdef FALLOC_FL_PUNCH_HOLE
+        fallocate(info->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, slot->offset, slot->capacity);
+#endif
+        memset(slot, 0, sizeof(SM_PageSlot));
+    }
+    size_t size = (size_t) numPages * sizeof(SM_PageSlot);
+    if (pwrite(info->mapFd, info->pageSlots + startPage, size, (off_t) startPage * sizeof(SM_PageSlot)) != (ssize_t) size)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+// Forget the checksums of numPages pages from startPage, they read back as zeros from now on
+static RC clearChecksums(SM_FileMgmtInfo *info, SM_BlockNum startPage, SM_BlockNum numPages) {
+    if (!info->checksums)
+        return RC_OK;
+
+    memset(info->pageChecksums + startPage, 0, (size_t) numPages * sizeof(uint32_t));
+    size_t size = (size_t) numPages * sizeof(uint32_t);
+    if (pwrite(info->checksumFd, info->pageChecksums + startPage, size, (off_t) startPage * sizeof(uint32_t)) != (ssize_t) size)
+        return RC_WRITE_FAILED;
+    return RC_OK;
+}
+
+// Drop the disk space of numPages pages from startPage, e.g. after their rows were deleted. The pages
+// keep their numbers and read back as zeros. Freed pages stay free, freePage and releasePages together
+// give a page back and its space.
+RC releasePages(SM_FileHandle *fHandle, SM_BlockNum startPage, SM_BlockNum numPages) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_rwlock_wrlock(&info->lock);
+    RC rc = RC_OK;
+    if (startPage < 0 || numPages < 0 || startPage + numPages > fHandle->totalNumPages)
+        rc = RC_READ_NON_EXISTING_PAGE;
+    else if (numPages > 0 && info->compressed)
+        rc = releaseSlots(info, startPage, numPages);
+    else if (numPages > 0)
+        rc = punchPages(info, startPage, numPages);
+    if (rc == RC_OK && numPages > 0)
+        rc = clearChecksums(info, startPage, numPages);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
+
+// Shrink the file to its first numPages pages. The pages past the new end and their disk space,
+// checksums, page map entries and free page bits are dropped. Segments past the end are emptied
+// rather than removed, other handles may have them open.
+RC truncatePageFile(SM_FileHandle *fHandle, SM_BlockNum numPages) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_rwlock_wrlock(&info->lock);
+    SM_BlockNum oldPages = fHandle->totalNumPages;
+    if (numPages < 0 || numPages > oldPages) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    RC rc = RC_OK;
+    if (info->compressed) {
+        // Data past the last slot still in use is cut off, slots in between become holes
+        rc = releaseSlots(info, numPages, oldPages - numPages);
+        off_t dataEnd = info->headerSize;
+        for (SM_BlockNum page = 0; page < numPages; page++)
+            if (info->pageSlots[page].offset + (off_t) info->pageSlots[page].capacity > dataEnd)
+                dataEnd = info->pageSlots[page].offset + info->pageSlots[page].capacity;
+        if (rc == RC_OK && (ftruncate(info->mapFd, (off_t) numPages * sizeof(SM_PageSlot)) != 0 || ftruncate(info->fd, dataEnd) != 0))
+            rc = RC_WRITE_FAILED;
+        info->dataEnd = dataEnd;
+    } else {
+        for (SM_BlockNum page = numPages; page < oldPages && rc == RC_OK; ) {
+            SM_BlockNum count = pagesInSegment(info, page, oldPages - page);
+            off_t offset;
+            int fd = pageLocation(info, page, false, &offset);
+            if (fd < 0 || ftruncate(fd, offset) != 0)
+                rc = RC_WRITE_FAILED;
+            page += count;
+        }
+        // Space reserved past the end went with it, and so does the mapping of it
+        if (info->allocatedPages > numPages)
+            info->allocatedPages = numPages;
+        if (rc == RC_OK && info->mode == SM_MODE_MMAP)
+            rc = unmapPagesPast(info, numPages);
+    }
+
+    // Nothing describes the dropped pages any more
+    if (rc == RC_OK && info->checksums) {
+        memset(info->pageChecksums + numPages, 0, (size_t) (info->checksumSlots - numPages) * sizeof(uint32_t));
+        if (ftruncate(info->checksumFd, (off_t) numPages * sizeof(uint32_t)) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+    SM_BlockNum keptWords = (numPages + FREE_MAP_WORD_BITS - 1) / FREE_MAP_WORD_BITS;
+    if (rc == RC_OK && info->freeMapFd >= 0) {
+        if (numPages % FREE_MAP_WORD_BITS != 0 && keptWords <= info->freeMapWords) {
+            info->freeMap[keptWords - 1] &= ((uint64_t) 1 << (numPages % FREE_MAP_WORD_BITS)) - 1;
+            if (pwrite(info->freeMapFd, &info->freeMap[keptWords - 1], sizeof(uint64_t), (off_t) (keptWords - 1) * sizeof(uint64_t)) != sizeof(uint64_t))
+                rc = RC_WRITE_FAILED;
+        }
+        if (keptWords < info->freeMapWords)
+            memset(info->freeMap + keptWords, 0, (size_t) (info->freeMapWords - keptWords) * sizeof(uint64_t));
+        if (rc == RC_OK && ftruncate(info->freeMapFd, (off_t) keptWords * sizeof(uint64_t)) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+
+    fHandle->totalNumPages = numPages;
+    info->prefetchedEnd = 0;
+    if (fHandle->curPagePos >= numPages)
+        setPagePos(fHandle, numPages > 0 ? numPages - 1 : 0);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
+
+// First page from fromPage on that takes disk space, totalNumPages if there is none. Pages in holes
+// read back as zeros, scans can skip straight to the page returned. A page that is not in a hole
+// can still be all zeros.
+SM_BlockNum nextDataPage(SM_FileHandle *fHandle, SM_BlockNum fromPage) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return fromPage;
+
+    pthread_rwlock_rdlock(&info->lock);
+    SM_BlockNum totalNumPages = fHandle->totalNumPages;
+    SM_BlockNum page = fromPage > 0 ? fromPage : 0;
+
+    if (info->compressed) {
+        while (page < totalNumPages && info->pageSlots[page].length == 0)
+            page++;
+        pthread_rwlock_unlock(&info->lock);
+        return page;
+    }
+
+    while (page < totalNumPages) {
+        SM_BlockNum count = pagesInSegment(info, page, totalNumPages - page);
+        off_t offset;
+        int fd = pageLocation(info, page, false, &offset);
+        if (fd < 0)
+            break;      // Cannot tell, the page may hold data
+
+        // Only the position of the shared descriptor moves, all I/O goes through pread and pwrite
+        off_t data = lseek(fd, offset, SEEK_DATA);
+        if (data < 0 && errno != ENXIO)
+            break;
+        SM_BlockNum dataPage = data < 0 ? page + count : page + (data - offset) / info->pageSize;
+        if (dataPage < page + count) {
+            page = dataPage;
+            break;
+        }
+        page += count;
     }
+    pthread_rwlock_unlock(&info->lock);
+    return page < totalNumPages ? page : totalNumPages;
+}
+
+/* VECTORED BLOCK I/O */
+/***********************/
 
-    // Calculate the total number of pages
-    fHandle->totalNumPages = fileSize / PAGE_SIZE;
+// Read numPages consecutive blocks starting at startPageNum, page i goes into memPages[i]
+static RC fileReadBlocks(SM_BlockNum startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // The whole range has to be inside the file
+    pthread_rwlock_rdlock(&info->lock);
+    if (startPageNum < 0 || numPages < 0 || startPageNum + numPages > fHandle->totalNumPages) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    if (numPages == 0) {
+        pthread_rwlock_unlock(&info->lock);
+        return RC_OK;
+    }
 
-    // Close the file
-    fclose(filePointer);
+    RC rc = transferRun(info, startPageNum, numPages, memPages, false);
+    if (rc == RC_OK)
+        readAhead(info, startPageNum, numPages, fHandle->totalNumPages);
+    pthread_rwlock_unlock(&info->lock);
+    if (rc != RC_OK)
+        return rc;
 
+    // Same as reading the pages one after the other
+    setPagePos(fHandle, startPageNum + numPages - 1);
     return RC_OK;
 }
 
+// Order blocks by page number, blocks for the same page keep the order they were given in
+static int compareBlockRefs(const void *a, const void *b) {
+    const SM_BlockRef *x = *(const SM_BlockRef **) a;
+    const SM_BlockRef *y = *(const SM_BlockRef **) b;
+    if (x->pageNum != y->pageNum)
+        return x->pageNum < y->pageNum ? -1 : 1;
+    return x < y ? -1 : (x > y);
+}
 
-// Close the page file
-RC closePageFile(SM_FileHandle *fHandle) {
-    filePointer = fopen(fHandle->fileName, "r+");    // Opening the file
-    int fileClosed = fclose(filePointer);           // Return code to store value of fclose
-	if (fileClosed != 0)                            // If not closed due to fclose failing...
-		return RC_FILE_NOT_FOUND;           
-    return RC_OK;                                   // File successfully closed
+// Write numBlocks (page number, buffer) pairs in any order. Pages with consecutive numbers are
+// gathered into a single pwritev, pages past the end of the file grow it first.
+static RC fileWriteBlocks(SM_BlockRef *blocks, int numBlocks, SM_FileHandle *fHandle) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (numBlocks <= 0)
+        return RC_OK;
+
+    // Sort pointers to the blocks so the caller's array stays untouched
+    SM_BlockRef **sorted = (SM_BlockRef **) malloc(numBlocks * sizeof(SM_BlockRef *));
+    SM_PageHandle *run = (SM_PageHandle *) malloc(numBlocks * sizeof(SM_PageHandle));
+    if (sorted == NULL || run == NULL) {
+        free(sorted);
+        free(run);
+        return RC_WRITE_FAILED;
+    }
+    for (int i = 0; i < numBlocks; i++)
+        sorted[i] = &blocks[i];
+    qsort(sorted, numBlocks, sizeof(SM_BlockRef *), compareBlockRefs);
+
+    RC rc = RC_OK;
+    SM_BlockNum lastPage = sorted[numBlocks - 1]->pageNum;
+    lockForWrite(fHandle, info, lastPage);
+    if (sorted[0]->pageNum < 0)
+        rc = RC_WRITE_FAILED;
+    else
+        rc = growHandle(fHandle, info, lastPage + 1);
+
+    for (int i = 0; i < numBlocks && rc == RC_OK; ) {
+        // Collect the run of consecutive pages starting at block i
+        SM_BlockNum startPage = sorted[i]->pageNum;
+        int runLength = 0;
+        while (i < numBlocks && sorted[i]->pageNum == startPage + runLength) {
+            // Several buffers for the same page: the last one given wins
+            while (i + 1 < numBlocks && sorted[i + 1]->pageNum == sorted[i]->pageNum)
+                i++;
+            run[runLength++] = sorted[i++]->memPage;
+        }
+        rc = transferRun(info, startPage, runLength, run, true);
+        if (rc == RC_OK)
+            setPagePos(fHandle, startPage + runLength - 1);
+    }
+    pthread_rwlock_unlock(&info->lock);
+
+    free(sorted);
+    free(run);
+    return rc;
 }
 
-//Destroying Page file
-RC destroyPageFile(char *fileName) {
-	// Opening file stream in read mode. 'r' mode creates an empty file for reading only.	
-	filePointer = fopen(fileName, "r");
-	
-	if(filePointer == NULL)
-		return RC_FILE_NOT_FOUND; 
-	
-	// Deleting the given filename so that it is no longer accessible.	
-	remove(fileName);
-	return RC_OK;
+// Append an empty block at the end of the file
+static RC fileAppendEmptyBlock(SM_FileHandle *fHandle) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Adding the empty page right after the last one
+    pthread_rwlock_wrlock(&info->lock);
+    RC rc = growHandle(fHandle, info, fHandle->totalNumPages + 1);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
 }
 
-/* READING BLOCKS FROM DISC */
-/****************************/
+// Ensure that the file has a certain number of pages
+static RC fileEnsureCapacity(SM_BlockNum numberOfPages, SM_FileHandle *fHandle) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
 
-// Read a specific block from the file
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    // Checking if the pageNumber parameter is less than Total number of pages and less than 0, then return respective error code
-	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_READ_NON_EXISTING_PAGE;
-
-	// Opening file stream in read mode. 'r' mode opens file for reading only.	
-	filePointer = fopen(fHandle->fileName, "r");
-
-	// Checking if file was successfully opened.
-	if(filePointer == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	// Setting the cursor(pointer) position of the file stream. Position is calculated by Page Number x Page Size
-	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(filePointer, (pageNum * PAGE_SIZE), SEEK_SET);
-	if(isSeekSuccess == 0) {
-		// We're reading the content and storing it in the location pointed out by memPage.
-		if(fread(memPage, sizeof(char), PAGE_SIZE, filePointer) < PAGE_SIZE)
-			return RC_FILE_NOT_FOUND;
-	} else {
-		return RC_READ_NON_EXISTING_PAGE; 
-	}
-    	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(filePointer); 
-	
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(filePointer);
-	
-    	return RC_OK;
+    // Grow in one step whatever the number of missing pages
+    lockForWrite(fHandle, info, numberOfPages - 1);
+    RC rc = growHandle(fHandle, info, numberOfPages);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
+
+/* BACKENDS */
+/************/
+
+static const SM_Backend fileBackend = {
+    .createPageFile = fileCreatePageFile,
+    .openPageFile = fileOpenPageFile,
+    .closePageFile = fileClosePageFile,
+    .destroyPageFile = fileDestroyPageFile,
+    .readBlock = fileReadBlock,
+    .writeBlock = fileWriteBlock,
+    .readBlocks = fileReadBlocks,
+    .writeBlocks = fileWriteBlocks,
+    .appendEmptyBlock = fileAppendEmptyBlock,
+    .ensureCapacity = fileEnsureCapacity,
+    .syncPageFile = fileSyncPageFile
+};
+
+#define MAX_BACKENDS 8
 
+// Backends by file name prefix, the memory backend is always there
+typedef struct SM_BackendPrefix {
+    const char *prefix;
+    const SM_Backend *backend;
+} SM_BackendPrefix;
+
+static pthread_mutex_t backendsLock = PTHREAD_MUTEX_INITIALIZER;
+static SM_BackendPrefix backends[MAX_BACKENDS] = { { SM_MEMORY_PREFIX, &memoryBackend } };
+static int numBackends = 1;
+
+// Backend storing the page file of the given name
+static const SM_Backend *backendFor(const char *fileName) {
+    const SM_Backend *backend = &fileBackend;
+    pthread_mutex_lock(&backendsLock);
+    for (int i = 0; i < numBackends; i++)
+        if (strncmp(fileName, backends[i].prefix, strlen(backends[i].prefix)) == 0) {
+            backend = backends[i].backend;
+            break;
+        }
+    pthread_mutex_unlock(&backendsLock);
+    return backend;
 }
 
-// Get the current block position in the file
-int getBlockPos(SM_FileHandle *fHandle) {
-    return fHandle->curPagePos; 
+// Backend of an open handle, NULL if the handle is not open
+static const SM_Backend *handleBackend(SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return NULL;
+    return fHandle->backend;
 }
 
-// Read the first block from the file
-RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    if (fHandle == NULL)                    // Ensure fHandle isn't NULL...
+// Store page files whose name starts with prefix in the given backend from now on
+RC registerStorageBackend(const char *prefix, const SM_Backend *backend) {
+    if (prefix == NULL || prefix[0] == '\0' || backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    RC rc = RC_OK;
+    pthread_mutex_lock(&backendsLock);
+    if (numBackends < MAX_BACKENDS) {
+        backends[numBackends].prefix = prefix;
+        backends[numBackends].backend = backend;
+        numBackends++;
+    } else {
+        rc = RC_WRITE_FAILED;
+    }
+    pthread_mutex_unlock(&backendsLock);
+    return rc;
+}
+
+// Monotonic clock in nanoseconds
+static long long nowNanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Count an operation of a handle that started at startNanos. Threads sharing the handle count at the same time.
+static void countIO(SM_FileHandle *fHandle, SM_IOKind kind, long long bytes, long long startNanos, RC rc) {
+    SM_IOCounter *counter = &fHandle->stats->ops[kind];
+    long long nanos = nowNanos() - startNanos;
+    int bucket = nanos > 1 ? 63 - __builtin_clzll((unsigned long long) nanos) : 0;
+    if (bucket >= SM_LATENCY_BUCKETS)
+        bucket = SM_LATENCY_BUCKETS - 1;
+
+    __atomic_fetch_add(&counter->count, 1, __ATOMIC_RELAXED);
+    if (rc != RC_OK)
+        __atomic_fetch_add(&counter->errors, 1, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_add(&counter->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counter->totalNanos, nanos, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counter->latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+// The storage manager interface hands every call to the backend of the file or handle,
+// timing and counting the block operations on the way
+
+RC createPageFileOptions(char *fileName, const SM_FileOptions *options) {
+    if (fileName == NULL)
         return RC_FILE_NOT_FOUND;
-    else if (fHandle->totalNumPages <= 0)   // Or empty
-        return RC_READ_NON_EXISTING_PAGE;
-    else {
-        fseek(filePointer, 0, SEEK_SET);    // filePointer will point to first position on file
-        RC firstBlock = fread(memPage, sizeof(char), PAGE_SIZE, filePointer);   // Getting first block
-        fHandle->curPagePos = 0;        // Update the current position to the first
-        if (firstBlock < 0 || firstBlock > PAGE_SIZE)   // Ensure right size, too
-            return RC_READ_NON_EXISTING_PAGE;
-        return RC_OK;       // :)
+    return backendFor(fileName)->createPageFile(fileName, options);
+}
+
+RC openPageFileSegmented(char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode, SM_BlockNum segmentPages) {
+    if (fileName == NULL || fHandle == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    SM_FileStats *stats = (SM_FileStats *) calloc(1, sizeof(SM_FileStats));
+    if (stats == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    const SM_Backend *backend = backendFor(fileName);
+    RC rc = backend->openPageFile(fileName, fHandle, mode, segmentPages);
+    if (rc != RC_OK) {
+        free(stats);
+        return rc;
     }
+    fHandle->backend = backend;
+    fHandle->stats = stats;
+    return RC_OK;
 }
 
-// Read the previous block relative to the current page position
-RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    if ((fHandle->curPagePos - 1) < 0)
-        return RC_READ_NON_EXISTING_PAGE;
-    else 
-        return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
+RC closePageFile(SM_FileHandle *fHandle) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    RC rc = backend->closePageFile(fHandle);
+    if (rc == RC_FILE_IN_USE)
+        return rc;
+    free(fHandle->stats);
+    fHandle->stats = NULL;
+    return rc;
 }
 
-RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return readBlock(fHandle->curPagePos, fHandle, memPage);
+RC syncPageFile(SM_FileHandle *fHandle) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    long long start = nowNanos();
+    RC rc = backend->syncPageFile(fHandle);
+    countIO(fHandle, SM_IO_SYNC, 0, start, rc);
+    return rc;
 }
 
-// Read the next block relative to the current page position
-RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    if ((fHandle->curPagePos + 1) > fHandle->totalNumPages)
-        return RC_READ_NON_EXISTING_PAGE;
-    else
-        return readBlock(fHandle->curPagePos - 1, fHandle, memPage); 
+RC destroyPageFile(char *fileName) {
+    if (fileName == NULL)
+        return RC_FILE_NOT_FOUND;
+    return backendFor(fileName)->destroyPageFile(fileName);
 }
 
-// Read the last block in the file
-RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+RC readBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    long long start = nowNanos();
+    RC rc = backend->readBlock(pageNum, fHandle, memPage);
+    countIO(fHandle, SM_IO_READ, fHandle->pageSize, start, rc);
+    return rc;
 }
 
-/* WRITING BLOCKS TO A PAGE FILE */
-/*********************************/
+RC writeBlock(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
 
-// Write a block at a specific position
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_WRITE_FAILED;
-	
-	filePointer = fopen(fHandle->fileName, "r+");
-	
-	if(filePointer == NULL)
-		return RC_FILE_NOT_FOUND;
-
-	int startPosition = pageNum * PAGE_SIZE;
-
-	if(pageNum == 0) { 
-		fseek(filePointer, startPosition, SEEK_SET);	
-		int i;
-		for(i = 0; i < PAGE_SIZE; i++) 
-		{
-			if(feof(filePointer))
-				 appendEmptyBlock(fHandle);	
-			fputc(memPage[i], filePointer);
-		}
-
-		fHandle->curPagePos = ftell(filePointer); 
-
-		fclose(filePointer);	
-	} else {	
-		fHandle->curPagePos = startPosition;
-		fclose(filePointer);
-		writeCurrentBlock(fHandle, memPage);
-	}
-	return RC_OK;
+    long long start = nowNanos();
+    RC rc = backend->writeBlock(pageNum, fHandle, memPage);
+    countIO(fHandle, SM_IO_WRITE, fHandle->pageSize, start, rc);
+    return rc;
 }
 
-// Write the current block
-RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    filePointer = fopen(fHandle->fileName, "r+");
-
-	// Checking if file was successfully opened.
-	if(filePointer == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	// Appending an empty block to make some space for the new content.
-	appendEmptyBlock(fHandle);
-
-	// Initiliazing file pointer
-	fseek(filePointer, fHandle->curPagePos, SEEK_SET);
-	
-	// Writing memPage contents to the file.
-	fwrite(memPage, sizeof(char), strlen(memPage), filePointer);
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(filePointer);
-    	
-	fclose(filePointer);
-	return RC_OK;
+RC readBlocks(SM_BlockNum startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    long long start = nowNanos();
+    RC rc = backend->readBlocks(startPageNum, numPages, fHandle, memPages);
+    countIO(fHandle, SM_IO_READ, (long long) numPages * fHandle->pageSize, start, rc);
+    return rc;
+}
+
+RC writeBlocks(SM_BlockRef *blocks, int numBlocks, SM_FileHandle *fHandle) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    long long start = nowNanos();
+    RC rc = backend->writeBlocks(blocks, numBlocks, fHandle);
+    countIO(fHandle, SM_IO_WRITE, (long long) numBlocks * fHandle->pageSize, start, rc);
+    return rc;
 }
 
-// Append an empty block at the end of the file
 RC appendEmptyBlock(SM_FileHandle *fHandle) {
-    SM_PageHandle emptyBlock = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-	
-	int isSeekSuccess = fseek(filePointer, 0, SEEK_END);
-	
-	if( isSeekSuccess == 0 ) {
-		fwrite(emptyBlock, sizeof(char), PAGE_SIZE, filePointer);
-	} else {
-		free(emptyBlock);
-		return RC_WRITE_FAILED;
-	}
-	
-	free(emptyBlock);
-	
-	fHandle->totalNumPages++;
-	return RC_OK;
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    long long start = nowNanos();
+    RC rc = backend->appendEmptyBlock(fHandle);
+    countIO(fHandle, SM_IO_APPEND, fHandle->pageSize, start, rc);
+    return rc;
 }
 
-// Ensure that the file has a certain number of pages
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
-    for (int i = numberOfPages-fHandle->totalNumPages; i>0; i--){
-        RC response = appendEmptyBlock(fHandle);
-        if (response != RC_OK)
-            return response;
+// Counted as an append of the pages added, a call finding them all there is not counted
+RC ensureCapacity(SM_BlockNum numberOfPages, SM_FileHandle *fHandle) {
+    const SM_Backend *backend = handleBackend(fHandle);
+    if (backend == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_BlockNum oldPages = fHandle->totalNumPages;
+    if (numberOfPages <= oldPages)
+        return backend->ensureCapacity(numberOfPages, fHandle);
+
+    long long start = nowNanos();
+    RC rc = backend->ensureCapacity(numberOfPages, fHandle);
+    countIO(fHandle, SM_IO_APPEND, (long long) (numberOfPages - oldPages) * fHandle->pageSize, start, rc);
+    return rc;
+}
+
+/* ASYNCHRONOUS BLOCK I/O */
+/**************************/
+
+#define ASYNC_WORKER_THREADS 4  // Workers of the thread backend
+
+struct SM_AsyncEngine {
+    SM_AsyncBackend backend;
+    int queueDepth;         // Most requests in flight (queued, submitted and not yet polled)
+
+    // Any thread may queue, submit and poll, lock guards everything below
+    pthread_mutex_t lock;
+    pthread_cond_t workDone;    // Broadcast whenever requests land on the completed list
+    int inFlight;
+    int started;            // Handed to the kernel or the workers and not finished yet
+
+    // Finished requests waiting for pollAsyncIO to run their callbacks
+    SM_AsyncRequest *completedHead, *completedTail;
+
+#ifdef SM_HAVE_IO_URING
+    // io_uring backend
+    int ringFd;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned toSubmit;      // SQEs queued since the last submitAsyncIO
+    bool ringWaiting;       // A poller sleeps in io_uring_enter, only it reaps the completion ring
+#endif
+
+    // Thread backend
+    pthread_t workers[ASYNC_WORKER_THREADS];
+    pthread_cond_t workAvailable;
+    SM_AsyncRequest *queuedHead, *queuedTail;       // Waiting for submitAsyncIO
+    SM_AsyncRequest *runnableHead, *runnableTail;   // Waiting for a worker
+    bool stopping;
+};
+
+// Append a request to a singly linked request queue
+static void pushRequest(SM_AsyncRequest **head, SM_AsyncRequest **tail, SM_AsyncRequest *req) {
+    req->next = NULL;
+    if (*tail != NULL)
+        (*tail)->next = req;
+    else
+        *head = req;
+    *tail = req;
+}
+
+// Do the transfer of a request synchronously, under the lock of its handle like readBlock and writeBlock
+static RC runRequest(SM_AsyncRequest *req) {
+    SM_FileMgmtInfo *info = (SM_FileMgmtInfo *) req->fileInfo;
+    if (req->isWrite && info->compressed)
+        pthread_rwlock_wrlock(&info->lock);
+    else
+        pthread_rwlock_rdlock(&info->lock);
+    RC rc = req->isWrite ? writePageAt(info, req->pageNum, req->memPage) : readPageAt(info, req->pageNum, req->memPage);
+    pthread_rwlock_unlock(&info->lock);
+    return rc;
+}
+
+// Mark a request as finished and let the caller know. Its handle may be closed from here on.
+static void completeRequest(SM_AsyncRequest *req, RC rc) {
+    SM_FileMgmtInfo *info = (SM_FileMgmtInfo *) req->fileInfo;
+    __atomic_sub_fetch(&info->pendingRequests, 1, __ATOMIC_RELEASE);
+    req->rc = rc;
+    req->done = true;
+    if (req->callback != NULL)
+        req->callback(req);
+}
+
+#ifdef SM_HAVE_IO_URING
+
+static int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+// Set up the submission and completion rings shared with the kernel
+static RC initRing(SM_AsyncEngine *engine) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    engine->ringFd = ioUringSetup(engine->queueDepth, &params);
+    if (engine->ringFd < 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    engine->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    engine->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (engine->cqRingSize > engine->sqRingSize)
+            engine->sqRingSize = engine->cqRingSize;
+        engine->cqRingSize = engine->sqRingSize;
+    }
+
+    engine->sqRing = mmap(NULL, engine->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, engine->ringFd, IORING_OFF_SQ_RING);
+    if (engine->sqRing == MAP_FAILED) {
+        close(engine->ringFd);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        engine->cqRing = engine->sqRing;
+    else
+        engine->cqRing = mmap(NULL, engine->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, engine->ringFd, IORING_OFF_CQ_RING);
+
+    engine->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    engine->sqes = mmap(NULL, engine->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, engine->ringFd, IORING_OFF_SQES);
+    if (engine->cqRing == MAP_FAILED || engine->sqes == MAP_FAILED) {
+        if (engine->cqRing != MAP_FAILED && engine->cqRing != engine->sqRing)
+            munmap(engine->cqRing, engine->cqRingSize);
+        if (engine->sqes != MAP_FAILED)
+            munmap(engine->sqes, engine->sqesSize);
+        munmap(engine->sqRing, engine->sqRingSize);
+        close(engine->ringFd);
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    char *sq = (char *) engine->sqRing;
+    char *cq = (char *) engine->cqRing;
+    engine->sqHead = (unsigned *) (sq + params.sq_off.head);
+    engine->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    engine->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    engine->sqArray = (unsigned *) (sq + params.sq_off.array);
+    engine->cqHead = (unsigned *) (cq + params.cq_off.head);
+    engine->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    engine->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    engine->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    engine->toSubmit = 0;
+
+    // Never have more requests in flight than the submission ring holds
+    if ((int) params.sq_entries < engine->queueDepth)
+        engine->queueDepth = params.sq_entries;
+    return RC_OK;
+}
+
+static void shutdownRing(SM_AsyncEngine *engine) {
+    munmap(engine->sqes, engine->sqesSize);
+    if (engine->cqRing != engine->sqRing)
+        munmap(engine->cqRing, engine->cqRingSize);
+    munmap(engine->sqRing, engine->sqRingSize);
+    close(engine->ringFd);
+}
+
+// Put a request in the next free submission queue entry, the kernel sees it on submitAsyncIO.
+// Returns false if the segment holding the page cannot be opened.
+static bool queueRingRequest(SM_AsyncEngine *engine, SM_AsyncRequest *req) {
+    SM_FileMgmtInfo *info = (SM_FileMgmtInfo *) req->fileInfo;
+    off_t offset;
+    int fd = pageLocation(info, req->pageNum, false, &offset);
+    if (fd < 0)
+        return false;
+
+    unsigned tail = *engine->sqTail;
+    unsigned index = tail & *engine->sqMask;
+    struct io_uring_sqe *sqe = &engine->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = (unsigned long long) offset;
+    sqe->addr = (unsigned long long) (uintptr_t) req->memPage;
+    sqe->len = info->pageSize;
+    sqe->user_data = (unsigned long long) (uintptr_t) req;
+
+    engine->sqArray[index] = index;
+    __atomic_store_n(engine->sqTail, tail + 1, __ATOMIC_RELEASE);
+    engine->toSubmit++;
+    return true;
+}
+
+// Move whatever the kernel completed to the completed list, called with the engine lock held
+static void reapRing(SM_AsyncEngine *engine) {
+    unsigned head = *engine->cqHead;
+
+    while (head != __atomic_load_n(engine->cqTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &engine->cqes[head & *engine->cqMask];
+        SM_AsyncRequest *req = (SM_AsyncRequest *) (uintptr_t) cqe->user_data;
+        int res = cqe->res;
+        head++;
+        __atomic_store_n(engine->cqHead, head, __ATOMIC_RELEASE);
+
+        // A short transfer is finished synchronously, errors are reported as they are
+        SM_FileMgmtInfo *info = (SM_FileMgmtInfo *) req->fileInfo;
+        RC rc = RC_OK;
+        if (res < 0)
+            rc = req->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        else if (res < info->pageSize)
+            rc = runRequest(req);
+        else if (info->checksums) {
+            pthread_rwlock_rdlock(&info->lock);
+            rc = req->isWrite ? recordChecksums(info, req->pageNum, 1, &req->memPage) : verifyChecksums(info, req->pageNum, 1, &req->memPage);
+            pthread_rwlock_unlock(&info->lock);
+        }
+
+        req->rc = rc;
+        engine->started--;
+        pushRequest(&engine->completedHead, &engine->completedTail, req);
+    }
+}
+
+#endif
+
+// Worker of the thread backend: run runnable requests until the engine shuts down
+static void *asyncWorker(void *arg) {
+    SM_AsyncEngine *engine = (SM_AsyncEngine *) arg;
+
+    pthread_mutex_lock(&engine->lock);
+    while (true) {
+        while (!engine->stopping && engine->runnableHead == NULL)
+            pthread_cond_wait(&engine->workAvailable, &engine->lock);
+        if (engine->runnableHead == NULL)
+            break;
+
+        SM_AsyncRequest *req = engine->runnableHead;
+        engine->runnableHead = req->next;
+        if (engine->runnableHead == NULL)
+            engine->runnableTail = NULL;
+
+        // The transfer itself runs without the lock
+        pthread_mutex_unlock(&engine->lock);
+        req->rc = runRequest(req);
+        pthread_mutex_lock(&engine->lock);
+
+        engine->started--;
+        pushRequest(&engine->completedHead, &engine->completedTail, req);
+        pthread_cond_broadcast(&engine->workDone);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return NULL;
+}
+
+static RC initThreads(SM_AsyncEngine *engine) {
+    engine->stopping = false;
+    for (int i = 0; i < ASYNC_WORKER_THREADS; i++) {
+        if (pthread_create(&engine->workers[i], NULL, asyncWorker, engine) != 0) {
+            // Stop the workers already started
+            pthread_mutex_lock(&engine->lock);
+            engine->stopping = true;
+            pthread_cond_broadcast(&engine->workAvailable);
+            pthread_mutex_unlock(&engine->lock);
+            for (int j = 0; j < i; j++)
+                pthread_join(engine->workers[j], NULL);
+            return RC_FILE_HANDLE_NOT_INIT;
+        }
+    }
+    return RC_OK;
+}
+
+// Create an engine allowing queueDepth requests in flight
+RC initAsyncIO(SM_AsyncEngine **engine, int queueDepth, SM_AsyncBackend backend) {
+    if (engine == NULL || queueDepth <= 0)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_AsyncEngine *e = (SM_AsyncEngine *) calloc(1, sizeof(SM_AsyncEngine));
+    if (e == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    e->queueDepth = queueDepth;
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->workAvailable, NULL);
+    pthread_cond_init(&e->workDone, NULL);
+
+    RC rc = RC_FILE_HANDLE_NOT_INIT;
+#ifdef SM_HAVE_IO_URING
+    if (backend != SM_ASYNC_THREADS) {
+        rc = initRing(e);
+        e->backend = SM_ASYNC_IO_URING;
+    }
+#endif
+    // Fall back to worker threads when io_uring is missing or not permitted
+    if (rc != RC_OK && backend != SM_ASYNC_IO_URING) {
+        rc = initThreads(e);
+        e->backend = SM_ASYNC_THREADS;
+    }
+
+    if (rc != RC_OK) {
+        pthread_cond_destroy(&e->workDone);
+        pthread_cond_destroy(&e->workAvailable);
+        pthread_mutex_destroy(&e->lock);
+        free(e);
+        return rc;
+    }
+
+    *engine = e;
+    return RC_OK;
+}
+
+// Wait for everything in flight and release the engine
+RC shutdownAsyncIO(SM_AsyncEngine *engine) {
+    if (engine == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    submitAsyncIO(engine);
+    while (engine->inFlight > 0)
+        pollAsyncIO(engine, engine->inFlight);
+
+#ifdef SM_HAVE_IO_URING
+    if (engine->backend == SM_ASYNC_IO_URING)
+        shutdownRing(engine);
+#endif
+    if (engine->backend == SM_ASYNC_THREADS) {
+        pthread_mutex_lock(&engine->lock);
+        engine->stopping = true;
+        pthread_cond_broadcast(&engine->workAvailable);
+        pthread_mutex_unlock(&engine->lock);
+        for (int i = 0; i < ASYNC_WORKER_THREADS; i++)
+            pthread_join(engine->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&engine->workDone);
+    pthread_cond_destroy(&engine->workAvailable);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+    return RC_OK;
+}
+
+SM_AsyncBackend getAsyncBackend(SM_AsyncEngine *engine) {
+    return engine->backend;
+}
+
+// Queue a request, it is started by the next submitAsyncIO
+static RC queueRequest(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_AsyncEngine *engine, SM_AsyncRequest *req, bool isWrite) {
+    SM_FileMgmtInfo *info = getMgmtInfo(fHandle);
+    if (info == NULL || engine == NULL || req == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // Asynchronous writes never grow the file, ensureCapacity has to be called first
+    pthread_rwlock_rdlock(&info->lock);
+    bool inFile = pageNum >= 0 && pageNum < fHandle->totalNumPages;
+    pthread_rwlock_unlock(&info->lock);
+    if (!inFile)
+        return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+
+    pthread_mutex_lock(&engine->lock);
+    if (engine->inFlight >= engine->queueDepth) {
+        pthread_mutex_unlock(&engine->lock);
+        return RC_IO_QUEUE_FULL;
+    }
+
+    req->pageNum = pageNum;
+    req->memPage = memPage;
+    req->isWrite = isWrite;
+    req->fileInfo = info;
+    req->rc = RC_OK;
+    req->done = false;
+    engine->inFlight++;
+    __atomic_add_fetch(&info->pendingRequests, 1, __ATOMIC_RELAXED);
+
+#ifdef SM_HAVE_IO_URING
+    if (engine->backend == SM_ASYNC_IO_URING) {
+        // The handle lock keeps the segment the entry points at open while it is filled in
+        pthread_rwlock_rdlock(&info->lock);
+        bool queued = info->mode != SM_MODE_MMAP && !info->compressed && canTransferDirectly(info, memPage) && queueRingRequest(engine, req);
+        pthread_rwlock_unlock(&info->lock);
+        if (!queued) {
+            // A mapped page is only a memcpy away and a bounced page needs a copy anyway.
+            // A compressed page has no fixed place the kernel could be pointed at.
+            req->rc = runRequest(req);
+            pushRequest(&engine->completedHead, &engine->completedTail, req);
+        }
+        pthread_mutex_unlock(&engine->lock);
+        return RC_OK;
+    }
+#endif
+
+    // Writing a compressed page can move it to a new slot at the end of the file, workers must not race for that
+    if (info->compressed) {
+        req->rc = runRequest(req);
+        pushRequest(&engine->completedHead, &engine->completedTail, req);
+    } else {
+        pushRequest(&engine->queuedHead, &engine->queuedTail, req);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return RC_OK;
+}
+
+RC readBlockAsync(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_AsyncEngine *engine, SM_AsyncRequest *req) {
+    return queueRequest(pageNum, fHandle, memPage, engine, req, false);
+}
+
+RC writeBlockAsync(SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_AsyncEngine *engine, SM_AsyncRequest *req) {
+    return queueRequest(pageNum, fHandle, memPage, engine, req, true);
+}
+
+// Start every request queued so far, called with the engine lock held
+static RC startQueued(SM_AsyncEngine *engine) {
+#ifdef SM_HAVE_IO_URING
+    if (engine->backend == SM_ASYNC_IO_URING) {
+        while (engine->toSubmit > 0) {
+            int submitted = ioUringEnter(engine->ringFd, engine->toSubmit, 0, 0);
+            if (submitted < 0)
+                return RC_WRITE_FAILED;
+            engine->toSubmit -= submitted;
+            engine->started += submitted;
+        }
+        return RC_OK;
+    }
+#endif
+
+    if (engine->queuedHead != NULL) {
+        for (SM_AsyncRequest *req = engine->queuedHead; req != NULL; req = req->next)
+            engine->started++;
+        if (engine->runnableTail != NULL)
+            engine->runnableTail->next = engine->queuedHead;
+        else
+            engine->runnableHead = engine->queuedHead;
+        engine->runnableTail = engine->queuedTail;
+        engine->queuedHead = engine->queuedTail = NULL;
+        pthread_cond_broadcast(&engine->workAvailable);
     }
     return RC_OK;
 }
+
+// Start every request queued since the last call
+RC submitAsyncIO(SM_AsyncEngine *engine) {
+    if (engine == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&engine->lock);
+    RC rc = startQueued(engine);
+    pthread_mutex_unlock(&engine->lock);
+    return rc;
+}
+
+// Collect finished requests, waiting until at least minCompletions of them are done
+// (or nothing is left in flight). Requests still queued are submitted first.
+// Callbacks run here, on the caller's thread. Returns the number of requests completed by this call,
+// fewer than asked for when other threads polling the engine collected the rest.
+int pollAsyncIO(SM_AsyncEngine *engine, int minCompletions) {
+    if (engine == NULL)
+        return 0;
+
+    int completed = 0;
+    pthread_mutex_lock(&engine->lock);
+    while (true) {
+        startQueued(engine);
+#ifdef SM_HAVE_IO_URING
+        if (engine->backend == SM_ASYNC_IO_URING && !engine->ringWaiting)
+            reapRing(engine);
+#endif
+
+        // Detach the finished list under the lock, run the callbacks without it
+        SM_AsyncRequest *req = engine->completedHead;
+        if (req != NULL) {
+            engine->completedHead = engine->completedTail = NULL;
+            for (SM_AsyncRequest *r = req; r != NULL; r = r->next)
+                engine->inFlight--;
+            pthread_mutex_unlock(&engine->lock);
+
+            while (req != NULL) {
+                SM_AsyncRequest *next = req->next;
+                completeRequest(req, req->rc);
+                completed++;
+                req = next;
+            }
+            pthread_mutex_lock(&engine->lock);
+            continue;
+        }
+        if (completed >= minCompletions || engine->started == 0)
+            break;
+
+#ifdef SM_HAVE_IO_URING
+        // One poller sleeps in the kernel, the others wait for it to hand out what it reaped.
+        // Nobody else reaps meanwhile, so the completions it waits for cannot be taken from under it.
+        if (engine->backend == SM_ASYNC_IO_URING && !engine->ringWaiting) {
+            unsigned wanted = minCompletions - completed;
+            if (wanted > (unsigned) engine->started)
+                wanted = engine->started;
+            engine->ringWaiting = true;
+            pthread_mutex_unlock(&engine->lock);
+            ioUringEnter(engine->ringFd, 0, wanted, IORING_ENTER_GETEVENTS);
+            pthread_mutex_lock(&engine->lock);
+            engine->ringWaiting = false;
+            reapRing(engine);
+            pthread_cond_broadcast(&engine->workDone);
+            continue;
+        }
+#endif
+        pthread_cond_wait(&engine->workDone, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return completed;
+}
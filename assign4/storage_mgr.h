@@ -3,31 +3,152 @@
 
 #include "dberror.h"
 
+// Page numbers are 64 bit so a page file is not limited to 2^31 pages
+typedef long long SM_BlockNum;
+
+// Page sizes a page file can be created with, PAGE_SIZE is the default
+#define SM_MIN_PAGE_SIZE 4096
+#define SM_MAX_PAGE_SIZE 65536
+
+// Bytes at the start of a page file describing it, the first page follows
+#define SM_HEADER_SIZE 4096
+
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+// Latency histograms have one bucket per power of two: bucket i counts operations
+// that took from 2^i up to 2^(i+1) nanoseconds, the last one everything slower
+#define SM_LATENCY_BUCKETS 40
+
+// Operations counted in the statistics of a file handle
+typedef enum SM_IOKind {
+	SM_IO_READ = 0,		// readBlock and everything reading through it, readBlocks
+	SM_IO_WRITE = 1,	// writeBlock, writeCurrentBlock, writeBlocks
+	SM_IO_APPEND = 2,	// appendEmptyBlock, ensureCapacity
+	SM_IO_SYNC = 3		// syncPageFile
+} SM_IOKind;
+#define SM_IO_KINDS 4
+
+// Counters of one kind of operation
+typedef struct SM_IOCounter {
+	long long count;	// calls, failed ones included
+	long long errors;	// calls that failed
+	long long bytes;	// bytes moved by the calls that succeeded
+	long long totalNanos;	// time spent in all calls
+	long long latency[SM_LATENCY_BUCKETS];	// calls by how long they took
+} SM_IOCounter;
+
+// Statistics of an open file handle, see storage_mgr_stat.h to read them
+typedef struct SM_FileStats {
+	SM_IOCounter ops[SM_IO_KINDS];
+} SM_FileStats;
+
 typedef struct SM_FileHandle {
 	char *fileName;
-	int totalNumPages;
-	int curPagePos;
+	SM_BlockNum totalNumPages;
+	SM_BlockNum curPagePos;
+	int pageSize;		// bytes per page, every page handle passed for this file holds that many
+	const struct SM_Backend *backend;	// what the pages are stored in, chosen when the file is opened
+	SM_FileStats *stats;	// I/O counted since the file was opened
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// One page of a scattered write: which page goes where and the memory it comes from
+typedef struct SM_BlockRef {
+	SM_BlockNum pageNum;
+	SM_PageHandle memPage;
+} SM_BlockRef;
+
+// Layout of a new page file, zero fields take the default
+typedef struct SM_FileOptions {
+	int pageSize;			// bytes per page, a power of two from SM_MIN_PAGE_SIZE to SM_MAX_PAGE_SIZE
+	SM_BlockNum segmentPages;	// pages per segment file, 0 keeps the page file in a single file
+	int checksums;			// keep a CRC32C of every page, verified when the page is read
+	int compressed;			// store pages compressed, such a file is opened with SM_MODE_PREAD only
+} SM_FileOptions;
+
+// How the blocks of an open page file are accessed
+typedef enum SM_OpenMode {
+	SM_MODE_PREAD = 0,	// positioned read/write on a file descriptor
+	SM_MODE_MMAP = 1,	// file mapped in memory, blocks are copied from/to the mapping
+	SM_MODE_DIRECT = 2	// O_DIRECT, bypasses the OS page cache; pass page aligned memory to avoid a copy
+} SM_OpenMode;
+
+// Page files named with this prefix, like "mem:tmp_table", live in anonymous memory of the
+// process instead of on disk. They last until destroyed or the process ends.
+#define SM_MEMORY_PREFIX "mem:"
+
+// Where the pages of a page file are stored. A backend registered for a name prefix handles every
+// page file whose name starts with it, other names go to the file backend. A backend checks page
+// numbers itself, like the file backend does. Optional features (free pages, checksums, growth
+// policy, asynchronous I/O) are only offered by the file backend.
+typedef struct SM_Backend {
+	RC (*createPageFile) (char *fileName, const SM_FileOptions *options);
+	RC (*openPageFile) (char *fileName, struct SM_FileHandle *fHandle, SM_OpenMode mode, SM_BlockNum segmentPages);
+	RC (*closePageFile) (struct SM_FileHandle *fHandle);
+	RC (*destroyPageFile) (char *fileName);
+	RC (*readBlock) (SM_BlockNum pageNum, struct SM_FileHandle *fHandle, SM_PageHandle memPage);
+	RC (*writeBlock) (SM_BlockNum pageNum, struct SM_FileHandle *fHandle, SM_PageHandle memPage);
+	RC (*readBlocks) (SM_BlockNum startPageNum, int numPages, struct SM_FileHandle *fHandle, SM_PageHandle *memPages);
+	RC (*writeBlocks) (SM_BlockRef *blocks, int numBlocks, struct SM_FileHandle *fHandle);
+	RC (*appendEmptyBlock) (struct SM_FileHandle *fHandle);
+	RC (*ensureCapacity) (SM_BlockNum numberOfPages, struct SM_FileHandle *fHandle);
+	RC (*syncPageFile) (struct SM_FileHandle *fHandle);
+} SM_Backend;
+
+// Which machinery runs asynchronous block I/O
+typedef enum SM_AsyncBackend {
+	SM_ASYNC_AUTO = 0,		// io_uring when the kernel allows it, worker threads otherwise
+	SM_ASYNC_IO_URING = 1,
+	SM_ASYNC_THREADS = 2
+} SM_AsyncBackend;
+
+// An engine may be shared between threads: any of them can queue, submit and
+// poll, and synchronous I/O may run on the same handles meanwhile. A request is
+// completed by whichever thread polls it, so its callback can run on another
+// thread than the one that queued it. shutdownAsyncIO must not race with other
+// calls on the engine.
+typedef struct SM_AsyncEngine SM_AsyncEngine;
+
+// One asynchronous block read or write. Owned by the caller and must stay
+// alive until pollAsyncIO reports it done. The file handle must stay open
+// until then too, closePageFile fails with RC_FILE_IN_USE while requests on
+// the handle are pending.
+typedef struct SM_AsyncRequest {
+	SM_BlockNum pageNum;
+	SM_PageHandle memPage;
+	RC rc;			// result of the transfer, valid once done is set
+	int done;
+	void (*callback) (struct SM_AsyncRequest *req);	// optional, run by pollAsyncIO on completion
+	void *userData;	// free for the caller
+	// bookkeeping of the storage manager
+	int isWrite;
+	void *fileInfo;
+	struct SM_AsyncRequest *next;
+} SM_AsyncRequest;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileOptions (char *fileName, const SM_FileOptions *options);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMode (char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode);
+extern RC openPageFileSegmented (char *fileName, SM_FileHandle *fHandle, SM_OpenMode mode, SM_BlockNum segmentPages);
 extern RC closePageFile (SM_FileHandle *fHandle);
+extern RC syncPageFile (SM_FileHandle *fHandle);
+extern RC setGroupCommitDelay (SM_FileHandle *fHandle, int maxDelayMicros);
 extern RC destroyPageFile (char *fileName);
+extern RC setDescriptorCacheSize (int maxIdle);
+extern RC registerStorageBackend (const char *prefix, const SM_Backend *backend);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern SM_BlockNum getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -35,9 +156,37 @@ extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (SM_BlockNum numberOfPages, SM_FileHandle *fHandle);
+extern RC setGrowthPolicy (SM_FileHandle *fHandle, int extentPages, int geometric);
+extern RC setChecksumVerification (SM_FileHandle *fHandle, int verify);
+extern RC setReadAhead (SM_FileHandle *fHandle, int windowPages);
+extern RC setSequentialHint (SM_FileHandle *fHandle, int sequential);
+extern RC dropPageCache (SM_FileHandle *fHandle, SM_BlockNum startPage, SM_BlockNum numPages);
+
+/* reusing freed pages */
+extern RC allocatePage (SM_FileHandle *fHandle, SM_BlockNum *pageNum);
+extern RC freePage (SM_FileHandle *fHandle, SM_BlockNum pageNum);
+extern int isPageFree (SM_FileHandle *fHandle, SM_BlockNum pageNum);
+
+/* giving disk space back */
+extern RC releasePages (SM_FileHandle *fHandle, SM_BlockNum startPage, SM_BlockNum numPages);
+extern RC truncatePageFile (SM_FileHandle *fHandle, SM_BlockNum numPages);
+extern SM_BlockNum nextDataPage (SM_FileHandle *fHandle, SM_BlockNum fromPage);
+
+/* vectored access to several blocks at once */
+extern RC readBlocks (SM_BlockNum startPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC writeBlocks (SM_BlockRef *blocks, int numBlocks, SM_FileHandle *fHandle);
+
+/* asynchronous block I/O */
+extern RC initAsyncIO (SM_AsyncEngine **engine, int queueDepth, SM_AsyncBackend backend);
+extern RC shutdownAsyncIO (SM_AsyncEngine *engine);
+extern SM_AsyncBackend getAsyncBackend (SM_AsyncEngine *engine);
+extern RC readBlockAsync (SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_AsyncEngine *engine, SM_AsyncRequest *req);
+extern RC writeBlockAsync (SM_BlockNum pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, SM_AsyncEngine *engine, SM_AsyncRequest *req);
+extern RC submitAsyncIO (SM_AsyncEngine *engine);
+extern int pollAsyncIO (SM_AsyncEngine *engine, int minCompletions);
 
 #endif
@@ -0,0 +1,167 @@
+#include "storage_mgr_stat.h"
+#include "storage_mgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// local functions
+static const char *ioKindName (SM_IOKind kind);
+
+// external functions
+
+// Copy the statistics of a handle, other threads may go on counting meanwhile
+RC
+getFileStats (SM_FileHandle *fHandle, SM_FileStats *stats)
+{
+	const long long *from;
+	long long *to;
+	size_t i;
+
+	if (fHandle == NULL || fHandle->stats == NULL || stats == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	from = (const long long *) fHandle->stats;
+	to = (long long *) stats;
+	for (i = 0; i < sizeof(SM_FileStats) / sizeof(long long); i++)
+		to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+	return RC_OK;
+}
+
+// Start counting from zero again
+RC
+resetFileStats (SM_FileHandle *fHandle)
+{
+	long long *counters;
+	size_t i;
+
+	if (fHandle == NULL || fHandle->stats == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	counters = (long long *) fHandle->stats;
+	for (i = 0; i < sizeof(SM_FileStats) / sizeof(long long); i++)
+		__atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+	return RC_OK;
+}
+
+// Nanoseconds that at least the given fraction (0.5 for p50, 0.999 for p999) of the
+// counted operations took at most, rounded up to the bucket bound. 0 if nothing was counted.
+long long
+getLatencyPercentile (const SM_IOCounter *counter, double percentile)
+{
+	long long total = 0, seen = 0, wanted;
+	int i;
+
+	for (i = 0; i < SM_LATENCY_BUCKETS; i++)
+		total += counter->latency[i];
+	if (total == 0)
+		return 0;
+
+	wanted = (long long) (percentile * total + 0.999999);
+	if (wanted < 1)
+		wanted = 1;
+	for (i = 0; i < SM_LATENCY_BUCKETS - 1; i++)
+	{
+		seen += counter->latency[i];
+		if (seen >= wanted)
+			break;
+	}
+	return 2LL << i;
+}
+
+void
+printFileStats (SM_FileHandle *fHandle)
+{
+	char *message = sprintFileStats(fHandle);
+
+	if (message == NULL)
+		return;
+	printf("%s", message);
+	free(message);
+}
+
+// One line per kind of operation: counts, bytes, mean and percentile latencies in microseconds
+char *
+sprintFileStats (SM_FileHandle *fHandle)
+{
+	SM_FileStats stats;
+	char *message;
+	int pos = 0;
+	int kind;
+
+	if (getFileStats(fHandle, &stats) != RC_OK)
+		return NULL;
+
+	message = (char *) malloc(256 + strlen(fHandle->fileName) + 160 * SM_IO_KINDS);
+	pos += sprintf(message + pos, "[File %s]\n", fHandle->fileName);
+	pos += sprintf(message + pos, "%-7s %10s %7s %14s %10s %10s %10s %10s\n",
+			"op", "count", "errors", "bytes", "mean us", "p50 us", "p99 us", "p999 us");
+	for (kind = 0; kind < SM_IO_KINDS; kind++)
+	{
+		SM_IOCounter *counter = &stats.ops[kind];
+		double mean = counter->count > 0 ? counter->totalNanos / 1000.0 / counter->count : 0;
+
+		pos += sprintf(message + pos, "%-7s %10lld %7lld %14lld %10.1f %10.1f %10.1f %10.1f\n",
+				ioKindName(kind), counter->count, counter->errors, counter->bytes, mean,
+				getLatencyPercentile(counter, 0.5) / 1000.0,
+				getLatencyPercentile(counter, 0.99) / 1000.0,
+				getLatencyPercentile(counter, 0.999) / 1000.0);
+	}
+	return message;
+}
+
+// Append the statistics of a handle to a text file, followed by the latency histogram of every
+// kind of operation as "<bucket upper bound in ns> <count>" lines of the buckets in use
+RC
+dumpFileStats (SM_FileHandle *fHandle, char *statsFileName)
+{
+	SM_FileStats stats;
+	char *message;
+	FILE *out;
+	int kind, i;
+
+	message = sprintFileStats(fHandle);
+	if (message == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	out = fopen(statsFileName, "a");
+	if (out == NULL)
+	{
+		free(message);
+		return RC_FILE_NOT_FOUND;
+	}
+
+	fputs(message, out);
+	free(message);
+	getFileStats(fHandle, &stats);
+	for (kind = 0; kind < SM_IO_KINDS; kind++)
+	{
+		if (stats.ops[kind].count == 0)
+			continue;
+		fprintf(out, "%s latency\n", ioKindName(kind));
+		for (i = 0; i < SM_LATENCY_BUCKETS; i++)
+			if (stats.ops[kind].latency[i] > 0)
+				fprintf(out, "%14lld %10lld\n", 2LL << i, stats.ops[kind].latency[i]);
+	}
+
+	if (fclose(out) != 0)
+		return RC_WRITE_FAILED;
+	return RC_OK;
+}
+
+const char *
+ioKindName (SM_IOKind kind)
+{
+	switch (kind)
+	{
+	case SM_IO_READ:
+		return "read";
+	case SM_IO_WRITE:
+		return "write";
+	case SM_IO_APPEND:
+		return "append";
+	case SM_IO_SYNC:
+		return "sync";
+	default:
+		return "?";
+	}
+}
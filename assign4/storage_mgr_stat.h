@@ -0,0 +1,16 @@
+#ifndef STORAGE_MGR_STAT_H
+#define STORAGE_MGR_STAT_H
+
+#include "storage_mgr.h"
+
+// statistics of an open page file
+RC getFileStats (SM_FileHandle *fHandle, SM_FileStats *stats);
+RC resetFileStats (SM_FileHandle *fHandle);
+long long getLatencyPercentile (const SM_IOCounter *counter, double percentile);
+
+// debug functions
+void printFileStats (SM_FileHandle *fHandle);
+char *sprintFileStats (SM_FileHandle *fHandle);
+RC dumpFileStats (SM_FileHandle *fHandle, char *statsFileName);
+
+#endif
@@ -0,0 +1,2241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <signal.h>
+#include <semaphore.h>
+
+#include "storage_mgr.h"
+#include "storage_mgr_stat.h"
+#include "crc32c.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_pagefile.bin"
+
+/* prototypes for test functions */
+static void testCreateOpenClose(void);
+static void testMultiPageContent(void);
+static void testMappedPageContent(void);
+static void testVectoredIO(void);
+static void testFlushPool(void);
+static void testAsyncIO(SM_AsyncBackend backend);
+static void testDirectIO(void);
+static void testExtentGrowth(void);
+static void testSegmentedFile(void);
+static void testPageSizes(void);
+static void testChecksums(void);
+static void testCompression(void);
+static void testFreePages(void);
+static void testDescriptorCache(void);
+static void testConcurrentAccess(void);
+static void testMemoryBackend(void);
+static void testReadAhead(void);
+static void testGroupCommit(void);
+static void testFailedGroupCommit(void);
+static void testFileStats(void);
+static void testReleasePages(void);
+static void testOneShotScan(void);
+static void testOneShotTableScan(void);
+static void testLargePool(void);
+static void testClockStrategy(void);
+static void testLfuStrategy(void);
+static void testLruKStrategy(void);
+static void testArcStrategy(void);
+
+/* main function running all tests */
+int
+main (void)
+{
+  testName = "";
+
+  initStorageManager();
+
+  testCreateOpenClose();
+  testMultiPageContent();
+  testMappedPageContent();
+  testVectoredIO();
+  testFlushPool();
+  testAsyncIO(SM_ASYNC_AUTO);
+  testAsyncIO(SM_ASYNC_THREADS);
+  testDirectIO();
+  testExtentGrowth();
+  testSegmentedFile();
+  testPageSizes();
+  testChecksums();
+  testCompression();
+  testFreePages();
+  testDescriptorCache();
+  testConcurrentAccess();
+  testMemoryBackend();
+  testReadAhead();
+  testGroupCommit();
+  testFailedGroupCommit();
+  testFileStats();
+  testReleasePages();
+  testOneShotScan();
+  testOneShotTableScan();
+  testLargePool();
+  testClockStrategy();
+  testLfuStrategy();
+  testLruKStrategy();
+  testArcStrategy();
+
+  return 0;
+}
+
+
+/* Try to create, open, and close a page file */
+void
+testCreateOpenClose(void)
+{
+  SM_FileHandle fh;
+
+  testName = "test create open and close methods";
+
+  TEST_CHECK(createPageFile (TESTPF));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE(strcmp(fh.fileName, TESTPF) == 0, "filename correct");
+  ASSERT_TRUE((fh.totalNumPages == 1), "expect 1 page in new file");
+  ASSERT_TRUE((fh.curPagePos == 0), "freshly opened file's page position should be 0");
+
+  TEST_CHECK(closePageFile (&fh));
+  ASSERT_ERROR(closePageFile (&fh), "closing an already closed handle should return an error");
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // after destruction trying to open the file should cause an error
+  ASSERT_TRUE((openPageFile(TESTPF, &fh) != RC_OK), "opening non-existing file should return an error.");
+
+  TEST_DONE();
+}
+
+/* Write several pages through one open handle and read them back in every direction */
+void
+testMultiPageContent(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i, p;
+
+  testName = "test multi page content";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+
+  // page p is filled with the digit p
+  for (p = 0; p < 4; p++)
+    {
+      memset(ph, '0' + p, PAGE_SIZE);
+      TEST_CHECK(writeBlock (p, &fh, ph));
+    }
+  ASSERT_EQUALS_INT(4, (int) fh.totalNumPages, "writing past the last page appends it");
+  ASSERT_ERROR(writeBlock (6, &fh, ph), "writing beyond the next page should fail");
+
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == '0' && ph[PAGE_SIZE - 1] == '0'), "first block has the expected content");
+  for (p = 1; p < 4; p++)
+    {
+      TEST_CHECK(readNextBlock (&fh, ph));
+      ASSERT_EQUALS_INT(p, (int) getBlockPos(&fh), "next block moves the page position forward");
+      for (i = 0; i < PAGE_SIZE; i++)
+        if (ph[i] != '0' + p)
+          break;
+      ASSERT_EQUALS_INT(PAGE_SIZE, i, "next block has the expected content");
+    }
+  ASSERT_ERROR(readNextBlock (&fh, ph), "reading after the last block should fail");
+
+  TEST_CHECK(readPreviousBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == '2'), "previous block has the expected content");
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == '3'), "last block has the expected content");
+  ASSERT_ERROR(readBlock (4, &fh, ph), "reading a non existing page should fail");
+
+  TEST_CHECK(appendEmptyBlock (&fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+  ASSERT_EQUALS_INT(8, (int) fh.totalNumPages, "file grown to requested capacity");
+  TEST_CHECK(readBlock (7, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "appended page is empty");
+  TEST_CHECK(closePageFile (&fh));
+
+  // the content survives reopening the file
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(8, (int) fh.totalNumPages, "reopened file keeps its pages");
+  TEST_CHECK(readBlock (2, &fh, ph));
+  ASSERT_TRUE((ph[0] == '2'), "page content persisted");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Same page traffic through a memory mapped handle, checked through a regular one */
+void
+testMappedPageContent(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int p;
+
+  testName = "test memory mapped page content";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_MODE_MMAP));
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "expect 1 page in new mapped file");
+
+  // appending one page at a time makes the mapping grow several times
+  for (p = 0; p < 10; p++)
+    {
+      memset(ph, 'a' + p, PAGE_SIZE);
+      TEST_CHECK(writeBlock (p, &fh, ph));
+    }
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "writing past the last page appends it");
+  TEST_CHECK(ensureCapacity (20, &fh));
+  ASSERT_EQUALS_INT(20, (int) fh.totalNumPages, "file grown to requested capacity");
+
+  TEST_CHECK(readBlock (3, &fh, ph));
+  ASSERT_TRUE((ph[0] == 'd' && ph[PAGE_SIZE - 1] == 'd'), "mapped block has the expected content");
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "grown page is empty");
+  TEST_CHECK(closePageFile (&fh));
+
+  // what was written through the mapping is in the file
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(20, (int) fh.totalNumPages, "reopened file keeps its pages");
+  TEST_CHECK(readBlock (9, &fh, ph));
+  ASSERT_TRUE((ph[0] == 'j' && ph[PAGE_SIZE - 1] == 'j'), "page written through the mapping persisted");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Scattered writes in random order read back with one vectored read */
+void
+testVectoredIO(void)
+{
+  SM_FileHandle fh;
+  SM_BlockRef blocks[6];
+  SM_PageHandle pages[8];
+  const int order[] = {5, 1, 2, 7, 0, 6};
+  int i;
+
+  testName = "test vectored block I/O";
+
+  for (i = 0; i < 8; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+
+  // pages 0-2 and 5-7 form two runs, 3 and 4 stay empty
+  for (i = 0; i < 6; i++)
+    {
+      memset(pages[order[i]], 'A' + order[i], PAGE_SIZE);
+      blocks[i].pageNum = order[i];
+      blocks[i].memPage = pages[order[i]];
+    }
+  TEST_CHECK(writeBlocks (blocks, 6, &fh));
+  ASSERT_EQUALS_INT(8, (int) fh.totalNumPages, "scattered write grows the file up to its last page");
+
+  for (i = 0; i < 8; i++)
+    memset(pages[i], '?', PAGE_SIZE);
+  TEST_CHECK(readBlocks (0, 8, &fh, pages));
+  ASSERT_EQUALS_INT(7, (int) getBlockPos(&fh), "page position is the last page read");
+  for (i = 0; i < 8; i++)
+    {
+      char expected = (i == 3 || i == 4) ? 0 : 'A' + i;
+      ASSERT_TRUE((pages[i][0] == expected && pages[i][PAGE_SIZE - 1] == expected), "vectored read has the expected content");
+    }
+  ASSERT_ERROR(readBlocks (6, 3, &fh, pages), "reading a range past the end should fail");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < 8; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* Pages flushed from the buffer pool end up on disk */
+void
+testFlushPool(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test flushing the buffer pool";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(initBufferPool (bm, TESTPF, 5, RS_FIFO, NULL));
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty (bm, h));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  TEST_CHECK(forceFlushPool (bm));
+  ASSERT_EQUALS_INT(5, getNumWriteIO(bm), "every dirty page written once");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(5, (int) fh.totalNumPages, "pool grew the file for the pages it pinned");
+  TEST_CHECK(readBlock (3, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-3", ph, "flushed page content is on disk");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(shutdownBufferPool (bm));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* counts completions reported through the request callback */
+static int asyncCallbacks;
+
+static void
+countCompletion(SM_AsyncRequest *req)
+{
+  asyncCallbacks++;
+}
+
+#define ASYNC_THREADS 4
+
+/* one of several threads driving the same engine */
+typedef struct AsyncWork {
+  SM_FileHandle *fh;
+  SM_AsyncEngine *engine;
+  int thread;
+  int failures;
+} AsyncWork;
+
+/* posts the semaphore of the thread that queued the request, whichever thread polled it */
+static void
+signalCompletion(SM_AsyncRequest *req)
+{
+  sem_post((sem_t *) req->userData);
+}
+
+/* Wait for a request, polling the engine like every other thread does */
+static RC
+awaitRequest(AsyncWork *work, SM_AsyncRequest *req, sem_t *done)
+{
+  while (sem_trywait(done) != 0)
+    pollAsyncIO(work->engine, 1);
+  return req->rc;
+}
+
+/* Write then read one page, synchronously on the last thread and through the engine on the others */
+static RC
+asyncWorkerWrite(AsyncWork *work, SM_PageHandle ph, SM_AsyncRequest *req, sem_t *done)
+{
+  if (work->thread == ASYNC_THREADS - 1)
+    return writeBlock (work->thread, work->fh, ph);
+  RC rc = writeBlockAsync (work->thread, work->fh, ph, work->engine, req);
+  return rc != RC_OK ? rc : awaitRequest(work, req, done);
+}
+
+static RC
+asyncWorkerRead(AsyncWork *work, SM_PageHandle ph, SM_AsyncRequest *req, sem_t *done)
+{
+  if (work->thread == ASYNC_THREADS - 1)
+    return readBlock (work->thread, work->fh, ph);
+  RC rc = readBlockAsync (work->thread, work->fh, ph, work->engine, req);
+  return rc != RC_OK ? rc : awaitRequest(work, req, done);
+}
+
+static void *
+asyncWorker(void *arg)
+{
+  AsyncWork *work = (AsyncWork *) arg;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_AsyncRequest req;
+  sem_t done;
+  int round;
+
+  sem_init(&done, 0, 0);
+  req.callback = signalCompletion;
+  req.userData = &done;
+  for (round = 0; round < 50; round++)
+    {
+      memset(ph, 'a' + work->thread + round % 8, PAGE_SIZE);
+      if (asyncWorkerWrite(work, ph, &req, &done) != RC_OK)
+        work->failures++;
+      memset(ph, 0, PAGE_SIZE);
+      if (asyncWorkerRead(work, ph, &req, &done) != RC_OK)
+        work->failures++;
+      if (ph[0] != 'a' + work->thread + round % 8 || ph[PAGE_SIZE - 1] != ph[0])
+        work->failures++;
+    }
+  sem_destroy(&done);
+  free(ph);
+  return NULL;
+}
+
+/* Write and read back pages through the asynchronous engine */
+void
+testAsyncIO(SM_AsyncBackend backend)
+{
+  SM_FileHandle fh;
+  SM_AsyncEngine *engine;
+  SM_AsyncRequest reqs[8];
+  SM_PageHandle pages[8];
+  pthread_t threads[ASYNC_THREADS];
+  AsyncWork work[ASYNC_THREADS];
+  int i, done;
+  RC rc;
+
+  testName = "test asynchronous block I/O";
+
+  for (i = 0; i < 8; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+  TEST_CHECK(initAsyncIO (&engine, 8, backend));
+  if (backend == SM_ASYNC_THREADS)
+    ASSERT_TRUE(getAsyncBackend(engine) == SM_ASYNC_THREADS, "thread backend used when asked for");
+
+  asyncCallbacks = 0;
+  for (i = 0; i < 8; i++)
+    {
+      memset(pages[i], 'a' + i, PAGE_SIZE);
+      reqs[i].callback = countCompletion;
+      TEST_CHECK(writeBlockAsync (i, &fh, pages[i], engine, &reqs[i]));
+    }
+  ASSERT_EQUALS_INT(RC_IO_QUEUE_FULL, writeBlockAsync (0, &fh, pages[0], engine, &reqs[0]), "queue depth is enforced");
+  ASSERT_ERROR(readBlockAsync (8, &fh, pages[0], engine, &reqs[0]), "asynchronous access past the end should fail");
+  TEST_CHECK(submitAsyncIO (engine));
+  for (done = 0; done < 8; )
+    done += pollAsyncIO(engine, 1);
+  ASSERT_EQUALS_INT(8, asyncCallbacks, "every write reported its completion");
+  for (i = 0; i < 8; i++)
+    ASSERT_TRUE(reqs[i].done && reqs[i].rc == RC_OK, "asynchronous write succeeded");
+
+  for (i = 0; i < 8; i++)
+    {
+      memset(pages[i], 0, PAGE_SIZE);
+      reqs[i].callback = NULL;
+      TEST_CHECK(readBlockAsync (7 - i, &fh, pages[i], engine, &reqs[i]));
+    }
+  done = pollAsyncIO(engine, 8);
+  ASSERT_EQUALS_INT(8, done, "all reads completed");
+  for (i = 0; i < 8; i++)
+    ASSERT_TRUE((pages[i][0] == 'h' - i && pages[i][PAGE_SIZE - 1] == 'h' - i), "asynchronous read has the expected content");
+
+  // The handle stays open while a request on it is pending
+  memset(pages[0], 0, PAGE_SIZE);
+  TEST_CHECK(readBlockAsync (2, &fh, pages[0], engine, &reqs[0]));
+  rc = closePageFile (&fh);
+  ASSERT_EQUALS_INT(RC_FILE_IN_USE, rc, "closing with a request queued fails");
+  TEST_CHECK(submitAsyncIO (engine));
+  done = pollAsyncIO(engine, 1);
+  ASSERT_EQUALS_INT(1, done, "pending read completed");
+  ASSERT_TRUE(reqs[0].rc == RC_OK && pages[0][0] == 'c', "pending read has the expected content");
+
+  // Threads share the engine, each one polls for whatever completed, next to a synchronous writer on the handle
+  for (i = 0; i < ASYNC_THREADS; i++)
+    {
+      work[i].fh = &fh;
+      work[i].engine = engine;
+      work[i].thread = i;
+      work[i].failures = 0;
+      ASSERT_TRUE(pthread_create(&threads[i], NULL, asyncWorker, &work[i]) == 0, "thread started");
+    }
+  for (i = 0; i < ASYNC_THREADS; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(0, work[i].failures, "every request of the thread succeeded");
+    }
+
+  TEST_CHECK(shutdownAsyncIO (engine));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < 8; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* O_DIRECT handles with aligned and unaligned memory, and a buffer pool on top of one */
+void
+testDirectIO(void)
+{
+  SM_FileHandle fh;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_PageHandle aligned, unaligned, raw;
+  int i;
+
+  testName = "test direct I/O";
+
+  TEST_CHECK(posix_memalign((void **) &aligned, PAGE_SIZE, PAGE_SIZE) == 0 ? RC_OK : RC_WRITE_FAILED);
+  raw = (SM_PageHandle) malloc(PAGE_SIZE + 1);
+  unaligned = raw + 1;
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_MODE_DIRECT));
+  memset(aligned, 'x', PAGE_SIZE);
+  TEST_CHECK(writeBlock (1, &fh, aligned));
+  memset(unaligned, 'y', PAGE_SIZE);
+  TEST_CHECK(writeBlock (2, &fh, unaligned));
+  TEST_CHECK(readBlock (1, &fh, unaligned));
+  ASSERT_TRUE((unaligned[0] == 'x' && unaligned[PAGE_SIZE - 1] == 'x'), "unaligned read through a direct handle");
+  TEST_CHECK(readBlock (2, &fh, aligned));
+  ASSERT_TRUE((aligned[0] == 'y' && aligned[PAGE_SIZE - 1] == 'y'), "aligned read through a direct handle");
+  TEST_CHECK(closePageFile (&fh));
+
+  // frames of the pool are page aligned and go to disk without a copy
+  TEST_CHECK(initBufferPoolMode (bm, TESTPF, 3, RS_FIFO, NULL, SM_MODE_DIRECT));
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      ASSERT_TRUE(((unsigned long) h->data % PAGE_SIZE) == 0, "frame is page aligned");
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty (bm, h));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 6; i++)
+    {
+      char expected[16];
+      sprintf(expected, "%s-%i", "Page", i);
+      TEST_CHECK(readBlock (i, &fh, aligned));
+      ASSERT_EQUALS_STRING(expected, aligned, "page written by the direct pool is on disk");
+    }
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(aligned);
+  free(raw);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* Growing a file reserves whole extents but keeps the size at the number of pages */
+void
+testExtentGrowth(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct stat fileInfo;
+
+  testName = "test extent based file growth";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_ERROR(setGrowthPolicy (&fh, 0, 0), "an extent needs at least one page");
+  TEST_CHECK(setGrowthPolicy (&fh, 32, 1));
+
+  TEST_CHECK(ensureCapacity (1000, &fh));
+  ASSERT_EQUALS_INT(1000, (int) fh.totalNumPages, "file grown to requested capacity in one step");
+  TEST_CHECK(appendEmptyBlock (&fh));
+  ASSERT_TRUE(stat(TESTPF, &fileInfo) == 0, "stat page file");
+  ASSERT_TRUE(fileInfo.st_size == SM_HEADER_SIZE + 1001L * PAGE_SIZE, "file size follows the page count, not the reservation");
+
+  memset(ph, '?', PAGE_SIZE);
+  TEST_CHECK(readBlock (999, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "grown page reads back empty");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(1001, (int) fh.totalNumPages, "reserved space is not counted as pages after reopening");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* A page file split in segment files of 4 pages reads and writes across the segment boundaries */
+void
+testSegmentedFile(void)
+{
+  SM_FileHandle fh;
+  SM_BlockRef blocks[10];
+  SM_PageHandle pages[10];
+  struct stat fileInfo;
+  int i;
+
+  testName = "test segmented page file";
+
+  for (i = 0; i < 10; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  ASSERT_ERROR(openPageFileSegmented (TESTPF, &fh, SM_MODE_MMAP, 4), "segments cannot be mapped");
+  TEST_CHECK(openPageFileSegmented (TESTPF, &fh, SM_MODE_PREAD, 4));
+
+  for (i = 0; i < 10; i++)
+    {
+      memset(pages[i], 'a' + i, PAGE_SIZE);
+      blocks[i].pageNum = i;
+      blocks[i].memPage = pages[i];
+    }
+  TEST_CHECK(writeBlocks (blocks, 10, &fh));
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "writing grows the file over three segments");
+  TEST_CHECK(closePageFile (&fh));
+
+  ASSERT_TRUE((stat(TESTPF, &fileInfo) == 0 && fileInfo.st_size == SM_HEADER_SIZE + 4 * PAGE_SIZE), "first segment is the header and 4 pages");
+  ASSERT_TRUE((stat(TESTPF ".1", &fileInfo) == 0 && fileInfo.st_size == 4 * PAGE_SIZE), "second segment is full");
+  ASSERT_TRUE((stat(TESTPF ".2", &fileInfo) == 0 && fileInfo.st_size == 2 * PAGE_SIZE), "last segment holds the rest");
+
+  // Reopening without a segment size picks up the one the file was written with
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(10, (int) fh.totalNumPages, "reopened file counts the pages of every segment");
+  for (i = 0; i < 10; i++)
+    memset(pages[i], '?', PAGE_SIZE);
+  TEST_CHECK(readBlocks (2, 7, &fh, pages));
+  for (i = 0; i < 7; i++)
+    ASSERT_TRUE((pages[i][0] == 'c' + i && pages[i][PAGE_SIZE - 1] == 'c' + i), "read across segments has the expected content");
+  TEST_CHECK(readBlock (9, &fh, pages[0]));
+  ASSERT_TRUE((pages[0][0] == 'j'), "last page is read from the last segment");
+  TEST_CHECK(ensureCapacity (13, &fh));
+  TEST_CHECK(closePageFile (&fh));
+  ASSERT_TRUE((stat(TESTPF ".3", &fileInfo) == 0 && fileInfo.st_size == 1 * PAGE_SIZE), "growing adds a new segment");
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  ASSERT_TRUE((stat(TESTPF ".1", &fileInfo) != 0 && stat(TESTPF ".3", &fileInfo) != 0), "destroying removes every segment");
+  for (i = 0; i < 10; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* Page files created with a non default page size, and files written before page files had a header */
+void
+testPageSizes(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileOptions options = { .pageSize = 16384 };
+  SM_FileOptions badOptions = { .pageSize = 12288 };
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct stat fileInfo;
+  int fd;
+
+  testName = "test page sizes";
+
+  ph = (SM_PageHandle) malloc(16384);
+
+  ASSERT_ERROR(createPageFileOptions (TESTPF, &badOptions), "page size has to be a power of two");
+  badOptions.pageSize = 2 * SM_MAX_PAGE_SIZE;
+  ASSERT_ERROR(createPageFileOptions (TESTPF, &badOptions), "page size has to be at most SM_MAX_PAGE_SIZE");
+
+  TEST_CHECK(createPageFileOptions (TESTPF, &options));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(16384, fh.pageSize, "page size is read from the header");
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "expect 1 page in new file");
+  memset(ph, 'x', 16384);
+  TEST_CHECK(writeBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+  ASSERT_TRUE((stat(TESTPF, &fileInfo) == 0 && fileInfo.st_size == SM_HEADER_SIZE + 2 * 16384), "file holds the header and two large pages");
+
+  // The buffer pool sizes its frames after the file
+  TEST_CHECK(initBufferPool (bm, TESTPF, 3, RS_FIFO, NULL));
+  TEST_CHECK(pinPage (bm, h, 1));
+  ASSERT_TRUE((h->data[0] == 'x' && h->data[16383] == 'x'), "pool frame holds the whole large page");
+  memset(h->data, 'y', 16384);
+  TEST_CHECK(markDirty (bm, h));
+  TEST_CHECK(unpinPage (bm, h));
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_MODE_MMAP));
+  TEST_CHECK(readBlock (1, &fh, ph));
+  ASSERT_TRUE((ph[0] == 'y' && ph[16383] == 'y'), "large page written back by the pool");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // A file without header is a plain sequence of PAGE_SIZE pages
+  fd = open(TESTPF, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  ASSERT_TRUE((fd >= 0 && ftruncate(fd, 3 * PAGE_SIZE) == 0 && pwrite(fd, "old", 4, PAGE_SIZE) == 4), "write a headerless file");
+  close(fd);
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "headerless file has default pages");
+  ASSERT_EQUALS_INT(3, (int) fh.totalNumPages, "headerless file pages start at its first byte");
+  TEST_CHECK(readBlock (1, &fh, ph));
+  ASSERT_EQUALS_STRING("old", ph, "headerless page content");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  free(ph);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* Pages of a file created with checksums are verified on every kind of read */
+void
+testChecksums(void)
+{
+  SM_FileOptions options = { .checksums = 1 };
+  SM_FileHandle fh;
+  SM_BlockRef blocks[3];
+  SM_PageHandle pages[3];
+  SM_AsyncEngine *engine;
+  SM_AsyncRequest req;
+  int i, fd;
+
+  testName = "test page checksums";
+
+  ASSERT_TRUE(crc32c(0, "123456789", 9) == 0xE3069283, "CRC32C check value");
+  ASSERT_TRUE(crc32c(crc32c(0, "1234", 4), "56789", 5) == 0xE3069283, "CRC32C continued over several calls");
+
+  for (i = 0; i < 3; i++)
+    pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_ERROR(setChecksumVerification (&fh, 1), "a file created without checksums cannot verify them");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(createPageFileOptions (TESTPF, &options));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 3; i++)
+    {
+      memset(pages[i], 'A' + i, PAGE_SIZE);
+      blocks[i].pageNum = i;
+      blocks[i].memPage = pages[i];
+    }
+  TEST_CHECK(writeBlocks (blocks, 3, &fh));
+  TEST_CHECK(ensureCapacity (5, &fh));
+  TEST_CHECK(closePageFile (&fh));
+
+  // Flip one byte of page 1 behind the storage manager's back
+  fd = open(TESTPF, O_RDWR);
+  ASSERT_TRUE((fd >= 0 && pwrite(fd, "?", 1, SM_HEADER_SIZE + PAGE_SIZE + 100) == 1), "corrupt a page on disk");
+  close(fd);
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(readBlock (0, &fh, pages[0]));
+  TEST_CHECK(readBlock (4, &fh, pages[0]));
+  ASSERT_EQUALS_INT(RC_CHECKSUM_MISMATCH, readBlock (1, &fh, pages[1]), "corrupt page detected on read");
+  ASSERT_EQUALS_INT(RC_CHECKSUM_MISMATCH, readBlocks (0, 3, &fh, pages), "corrupt page detected on vectored read");
+
+  TEST_CHECK(initAsyncIO (&engine, 1, SM_ASYNC_AUTO));
+  req.callback = NULL;
+  TEST_CHECK(readBlockAsync (1, &fh, pages[1], engine, &req));
+  pollAsyncIO(engine, 1);
+  ASSERT_EQUALS_INT(RC_CHECKSUM_MISMATCH, req.rc, "corrupt page detected on asynchronous read");
+  TEST_CHECK(shutdownAsyncIO (engine));
+
+  TEST_CHECK(setChecksumVerification (&fh, 0));
+  TEST_CHECK(readBlock (1, &fh, pages[1]));
+  ASSERT_TRUE((pages[1][100] == '?' && pages[1][0] == 'B'), "corrupt page readable with verification off");
+
+  // Rewriting the page makes it valid again
+  TEST_CHECK(setChecksumVerification (&fh, 1));
+  TEST_CHECK(writeBlock (1, &fh, pages[1]));
+  TEST_CHECK(readBlock (1, &fh, pages[1]));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_MODE_MMAP));
+  TEST_CHECK(readBlocks (0, 3, &fh, pages));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  ASSERT_TRUE(access(TESTPF ".crc", F_OK) != 0, "destroying removes the checksum file");
+  for (i = 0; i < 3; i++)
+    free(pages[i]);
+
+  TEST_DONE();
+}
+
+/* Fill a page the way a record table does: short strings in wide zero padded slots */
+static void
+fillRecordPage(SM_PageHandle ph, int seed)
+{
+  int slot;
+
+  memset(ph, 0, PAGE_SIZE);
+  for (slot = 0; slot < PAGE_SIZE / 128; slot++)
+    sprintf(ph + slot * 128, "%d-record-%d", seed, slot);
+}
+
+/* Compressed pages read back as they were written and take much less room */
+void
+testCompression(void)
+{
+  SM_FileOptions options = { .compressed = 1, .checksums = 1 };
+  SM_FileHandle fh;
+  SM_PageHandle ph, expected;
+  SM_AsyncEngine *engine;
+  SM_AsyncRequest req;
+  struct stat fileInfo;
+  struct rlimit fileLimit, sizeLimit;
+  void (*previousHandler)(int);
+  int i;
+  RC rc;
+
+  testName = "test page compression";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  expected = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  options.segmentPages = 8;
+  ASSERT_ERROR(createPageFileOptions (TESTPF, &options), "compressed files cannot be segmented");
+  options.segmentPages = 0;
+
+  TEST_CHECK(createPageFileOptions (TESTPF, &options));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 32; i++)
+    {
+      fillRecordPage(ph, i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  // One page that does not compress
+  srand(42);
+  for (i = 0; i < PAGE_SIZE; i++)
+    ph[i] = (char) rand();
+  TEST_CHECK(writeBlock (32, &fh, ph));
+  TEST_CHECK(ensureCapacity (40, &fh));
+  TEST_CHECK(closePageFile (&fh));
+
+  ASSERT_TRUE((stat(TESTPF, &fileInfo) == 0 && fileInfo.st_size < SM_HEADER_SIZE + 10 * PAGE_SIZE), "compressed pages take less room than 40 plain ones");
+  ASSERT_ERROR(openPageFileMode (TESTPF, &fh, SM_MODE_MMAP), "compressed files cannot be mapped");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(40, (int) fh.totalNumPages, "page count comes from the page map");
+  for (i = 0; i < 32; i++)
+    {
+      fillRecordPage(expected, i);
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "compressed page reads back as written");
+    }
+  srand(42);
+  for (i = 0; i < PAGE_SIZE; i++)
+    expected[i] = (char) rand();
+  TEST_CHECK(readBlock (32, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "page stored without compression reads back as written");
+  TEST_CHECK(readBlock (39, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "page never written is empty");
+
+  // A page that no longer fits its slot moves to a new one
+  TEST_CHECK(writeBlock (3, &fh, expected));
+  TEST_CHECK(readBlock (3, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "grown page reads back from its new slot");
+  fillRecordPage(expected, 4);
+  TEST_CHECK(readBlock (4, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "neighbouring page untouched by the move");
+
+  TEST_CHECK(initAsyncIO (&engine, 1, SM_ASYNC_THREADS));
+  req.callback = NULL;
+  TEST_CHECK(readBlockAsync (4, &fh, ph, engine, &req));
+  ASSERT_EQUALS_INT(1, pollAsyncIO(engine, 1), "asynchronous read of a compressed page completes");
+  ASSERT_TRUE((req.rc == RC_OK && memcmp(ph, expected, PAGE_SIZE) == 0), "asynchronous read decompresses the page");
+  TEST_CHECK(shutdownAsyncIO (engine));
+
+  // A move whose write fails leaves the page where it was. The file cannot grow past its size here.
+  stat(TESTPF, &fileInfo);
+  getrlimit(RLIMIT_FSIZE, &fileLimit);
+  sizeLimit = fileLimit;
+  sizeLimit.rlim_cur = fileInfo.st_size;
+  previousHandler = signal(SIGXFSZ, SIG_IGN);
+  setrlimit(RLIMIT_FSIZE, &sizeLimit);
+  srand(43);
+  for (i = 0; i < PAGE_SIZE; i++)
+    ph[i] = (char) rand();
+  rc = writeBlock(5, &fh, ph);
+  setrlimit(RLIMIT_FSIZE, &fileLimit);
+  signal(SIGXFSZ, previousHandler);
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, rc, "moving a page past the file size limit fails");
+  fillRecordPage(expected, 5);
+  TEST_CHECK(readBlock (5, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "page of a failed move reads back from its old slot");
+  srand(43);
+  for (i = 0; i < PAGE_SIZE; i++)
+    expected[i] = (char) rand();
+  TEST_CHECK(writeBlock (5, &fh, expected));
+  TEST_CHECK(readBlock (5, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "page moves once the file can grow");
+  stat(TESTPF, &fileInfo);
+  ASSERT_TRUE(fileInfo.st_size < (off_t) sizeLimit.rlim_cur + 2 * PAGE_SIZE, "failed move took no room");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  ASSERT_TRUE(access(TESTPF ".map", F_OK) != 0, "destroying removes the page map");
+  free(ph);
+  free(expected);
+
+  TEST_DONE();
+}
+
+/* Freed pages are handed out again before the file grows, also after reopening */
+void
+testFreePages(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  SM_BlockNum pageNum;
+  int i;
+
+  testName = "test free page reuse";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (200, &fh));
+  memset(ph, 'x', PAGE_SIZE);
+  for (i = 0; i < 200; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(200, (int) pageNum, "nothing free, the file grows");
+
+  TEST_CHECK(freePage (&fh, 150));
+  TEST_CHECK(freePage (&fh, 70));
+  ASSERT_ERROR(freePage (&fh, 70), "a page cannot be freed twice");
+  ASSERT_ERROR(freePage (&fh, 500), "a page past the end cannot be freed");
+  ASSERT_TRUE(isPageFree (&fh, 70), "freed page is marked free");
+  ASSERT_TRUE(!isPageFree (&fh, 71), "other pages stay in use");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((isPageFree (&fh, 70) && isPageFree (&fh, 150)), "free pages survive reopening");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(70, (int) pageNum, "lowest free page is reused first");
+  TEST_CHECK(readBlock (70, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "reused page is empty");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(150, (int) pageNum, "next free page is reused");
+  TEST_CHECK(allocatePage (&fh, &pageNum));
+  ASSERT_EQUALS_INT(201, (int) pageNum, "file grows once no page is free");
+  ASSERT_EQUALS_INT(202, (int) fh.totalNumPages, "only one page was appended");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  ASSERT_TRUE(access(TESTPF ".fsm", F_OK) != 0, "destroying removes the free page bitmap");
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Descriptors the process has open */
+static int
+countOpenFds(void)
+{
+  DIR *dir = opendir("/proc/self/fd");
+  struct dirent *entry;
+  int count = 0;
+
+  if (dir == NULL)
+    return -1;
+  while ((entry = readdir(dir)) != NULL)
+    if (entry->d_name[0] != '.')
+      count++;
+  closedir(dir);
+  return count - 1;   // Not counting the directory itself
+}
+
+/* Handles of one file share a descriptor, closed files keep theirs up to the cache size */
+void
+testDescriptorCache(void)
+{
+  char *names[] = { "test_fdcache_0.bin", "test_fdcache_1.bin", "test_fdcache_2.bin", "test_fdcache_3.bin" };
+  SM_FileHandle fh, other;
+  SM_PageHandle ph;
+  int baseFds, i;
+
+  testName = "test descriptor cache";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  TEST_CHECK(setDescriptorCacheSize (2));
+  for (i = 0; i < 4; i++)
+    TEST_CHECK(createPageFile (names[i]));
+  baseFds = countOpenFds();
+
+  TEST_CHECK(openPageFile (names[0], &fh));
+  TEST_CHECK(openPageFile (names[0], &other));
+  ASSERT_EQUALS_INT(baseFds + 1, countOpenFds(), "two handles of one file share a descriptor");
+  memset(ph, 'a', PAGE_SIZE);
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock (0, &other, ph));
+  ASSERT_TRUE(ph[0] == 'a', "the other handle reads what the first wrote");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(readBlock (0, &other, ph));
+  TEST_CHECK(closePageFile (&other));
+  ASSERT_EQUALS_INT(baseFds + 1, countOpenFds(), "descriptor stays cached after the last close");
+
+  for (i = 0; i < 4; i++)
+    {
+      TEST_CHECK(openPageFile (names[i], &fh));
+      TEST_CHECK(closePageFile (&fh));
+    }
+  ASSERT_EQUALS_INT(baseFds + 2, countOpenFds(), "idle descriptors are bounded by the cache size");
+
+  for (i = 0; i < 4; i++)
+    TEST_CHECK(destroyPageFile (names[i]));
+  ASSERT_EQUALS_INT(baseFds, countOpenFds(), "destroying a file closes its cached descriptor");
+
+  TEST_CHECK(setDescriptorCacheSize (64));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Pages a thread of testConcurrentAccess writes and reads back, the threads use disjoint pages */
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_PAGES 64
+
+typedef struct ConcurrentWork {
+  SM_FileHandle *fh;
+  int thread;
+  int failures;
+} ConcurrentWork;
+
+static void *
+concurrentWorker(void *arg)
+{
+  ConcurrentWork *work = (ConcurrentWork *) arg;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  int round, i;
+
+  for (round = 0; round < 4; round++)
+    for (i = 0; i < CONCURRENT_PAGES; i++)
+      {
+        SM_BlockNum page = i * CONCURRENT_THREADS + work->thread;
+        memset(ph, 'a' + work->thread + round, PAGE_SIZE);
+        if (writeBlock (page, work->fh, ph) != RC_OK)
+          work->failures++;
+        memset(ph, 0, PAGE_SIZE);
+        if (readBlock (page, work->fh, ph) != RC_OK || ph[0] != 'a' + work->thread + round || ph[PAGE_SIZE - 1] != ph[0])
+          work->failures++;
+      }
+  free(ph);
+  return NULL;
+}
+
+static void *
+appendWorker(void *arg)
+{
+  ConcurrentWork *work = (ConcurrentWork *) arg;
+  int i;
+
+  for (i = 0; i < 200; i++)
+    if (appendEmptyBlock (work->fh) != RC_OK)
+      work->failures++;
+  return NULL;
+}
+
+/* Threads sharing one handle read and write their own pages while another one grows the file */
+void
+testConcurrentAccess(void)
+{
+  SM_FileOptions options = { .checksums = 1 };
+  SM_FileHandle fh;
+  pthread_t threads[CONCURRENT_THREADS + 1];
+  ConcurrentWork work[CONCURRENT_THREADS + 1];
+  int i;
+
+  testName = "test concurrent access to one handle";
+
+  TEST_CHECK(createPageFileOptions (TESTPF, &options));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (CONCURRENT_THREADS * CONCURRENT_PAGES, &fh));
+
+  for (i = 0; i <= CONCURRENT_THREADS; i++)
+    {
+      work[i].fh = &fh;
+      work[i].thread = i;
+      work[i].failures = 0;
+      ASSERT_TRUE(pthread_create(&threads[i], NULL, i < CONCURRENT_THREADS ? concurrentWorker : appendWorker, &work[i]) == 0, "thread started");
+    }
+  for (i = 0; i <= CONCURRENT_THREADS; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(0, work[i].failures, "every read and write of the thread succeeded");
+    }
+  ASSERT_EQUALS_INT(CONCURRENT_THREADS * CONCURRENT_PAGES + 200, (int) fh.totalNumPages, "every append took effect");
+  TEST_CHECK(closePageFile (&fh));
+
+  // The checksums written alongside the appends still match every page
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  work[0].fh = &fh;
+  work[0].thread = 0;
+  work[0].failures = 0;
+  concurrentWorker(&work[0]);
+  ASSERT_EQUALS_INT(0, work[0].failures, "pages read back with matching checksums after reopening");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  TEST_DONE();
+}
+
+/* Page files named with the memory prefix keep their pages in memory, also under a buffer pool */
+void
+testMemoryBackend(void)
+{
+  char *memFile = SM_MEMORY_PREFIX "test_pagefile";
+  SM_FileOptions options = { .pageSize = 8192 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh, other;
+  SM_PageHandle ph, pages[3];
+  int i;
+
+  testName = "test in-memory backend";
+
+  ph = (SM_PageHandle) malloc(8192);
+
+  ASSERT_ERROR(openPageFile (memFile, &fh), "memory file does not exist before it is created");
+  TEST_CHECK(createPageFileOptions (memFile, &options));
+  ASSERT_TRUE(access(memFile, F_OK) != 0, "memory file is not on disk");
+
+  TEST_CHECK(openPageFile (memFile, &fh));
+  ASSERT_EQUALS_INT(1, (int) fh.totalNumPages, "new memory file has one page");
+  ASSERT_EQUALS_INT(8192, fh.pageSize, "memory file has the page size it was created with");
+  TEST_CHECK(readBlock (0, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[8191] == 0), "first page is empty");
+
+  for (i = 0; i < 40; i++)
+    {
+      memset(ph, 'a' + i % 26, 8192);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  ASSERT_EQUALS_INT(40, (int) fh.totalNumPages, "writing past the end appends");
+  ASSERT_ERROR(writeBlock (42, &fh, ph), "writing further past the end fails");
+  TEST_CHECK(ensureCapacity (50, &fh));
+  TEST_CHECK(readBlock (45, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[8191] == 0), "added page is empty");
+  ASSERT_ERROR(readBlock (50, &fh, ph), "reading past the end fails");
+  ASSERT_ERROR(setGrowthPolicy (&fh, 4, 0), "file backend features are not there");
+
+  TEST_CHECK(openPageFile (memFile, &other));
+  ASSERT_EQUALS_INT(50, (int) other.totalNumPages, "another handle sees the same pages");
+  for (i = 0; i < 3; i++)
+    pages[i] = (SM_PageHandle) malloc(8192);
+  TEST_CHECK(readBlocks (20, 3, &other, pages));
+  ASSERT_TRUE((pages[0][0] == 'u' && pages[2][8191] == 'w'), "vectored read of the other handle");
+  TEST_CHECK(closePageFile (&other));
+  TEST_CHECK(closePageFile (&fh));
+
+  // Destroying while open keeps the pages until the last handle closes
+  TEST_CHECK(openPageFile (memFile, &fh));
+  TEST_CHECK(destroyPageFile (memFile));
+  ASSERT_ERROR(openPageFile (memFile, &other), "destroyed memory file cannot be opened");
+  TEST_CHECK(readBlock (39, &fh, ph));
+  ASSERT_TRUE(ph[0] == 'n', "open handle still reads its pages");
+  TEST_CHECK(closePageFile (&fh));
+
+  // The buffer pool runs on a memory file as it does on a file
+  TEST_CHECK(createPageFile (memFile));
+  TEST_CHECK(initBufferPool (bm, memFile, 3, RS_FIFO, NULL));
+  for (i = 0; i < 10; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty (bm, h));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  TEST_CHECK(shutdownBufferPool (bm));
+  TEST_CHECK(openPageFile (memFile, &fh));
+  TEST_CHECK(readBlock (7, &fh, ph));
+  ASSERT_EQUALS_STRING("Page-7", ph, "pool wrote the page to the memory file");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (memFile));
+  ASSERT_ERROR(destroyPageFile (memFile), "memory file is gone");
+
+  for (i = 0; i < 3; i++)
+    free(pages[i]);
+  free(ph);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* Pages from first on, numPages of them, that are in the page cache. Waits up to a second
+ * for at least one of them to arrive when wait is set, read-ahead completes in the background. */
+static int
+residentPages(char *fileName, int first, int numPages, int wait)
+{
+  size_t size = SM_HEADER_SIZE + (size_t) (first + numPages) * PAGE_SIZE;
+  unsigned char *vec = (unsigned char *) malloc(size / PAGE_SIZE);
+  int fd = open(fileName, O_RDONLY);
+  char *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  int count = 0, tries, i;
+
+  for (tries = 0; tries < 100; tries++)
+    {
+      mincore(map, size, vec);
+      count = 0;
+      for (i = 0; i < numPages; i++)
+        count += vec[SM_HEADER_SIZE / PAGE_SIZE + first + i] & 1;
+      if (count > 0 || !wait)
+        break;
+      usleep(10000);
+    }
+  munmap(map, size);
+  close(fd);
+  free(vec);
+  return count;
+}
+
+/* Drop the pages of a file from the page cache, false if the file system keeps them */
+static int
+dropCachedPages(char *fileName, int numPages)
+{
+  int fd = open(fileName, O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+  return residentPages(fileName, 0, numPages, 0) == 0;
+}
+
+/* A scan gets the pages ahead of it read in the background, random reads do not */
+void
+testReadAhead(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test sequential read-ahead";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  memset(ph, 'r', PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (200, &fh));
+  for (i = 0; i < 200; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  ASSERT_ERROR(setReadAhead (&fh, -1), "negative window is refused");
+  TEST_CHECK(setReadAhead (&fh, 64));
+
+  // Only meaningful where the page cache can be emptied
+  if (dropCachedPages(TESTPF, 200))
+    {
+      TEST_CHECK(readBlock (0, &fh, ph));
+      TEST_CHECK(readBlock (100, &fh, ph));
+      TEST_CHECK(readBlock (7, &fh, ph));
+      ASSERT_EQUALS_INT(0, residentPages(TESTPF, 40, 20, 0), "random reads read nothing ahead");
+
+      TEST_CHECK(readFirstBlock (&fh, ph));
+      for (i = 1; i < 4; i++)
+        TEST_CHECK(readNextBlock (&fh, ph));
+      ASSERT_TRUE(residentPages(TESTPF, 40, 20, 1) > 0, "scan has the window ahead of it read");
+
+      TEST_CHECK(setReadAhead (&fh, 0));
+      ASSERT_TRUE(dropCachedPages(TESTPF, 200), "page cache emptied again");
+      for (i = 120; i < 124; i++)
+        TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_EQUALS_INT(0, residentPages(TESTPF, 160, 20, 0), "nothing read ahead with read-ahead off");
+    }
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Each thread of testGroupCommit writes its own page and makes it durable, over and over */
+static void *
+syncWorker(void *arg)
+{
+  ConcurrentWork *work = (ConcurrentWork *) arg;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  int i;
+
+  for (i = 0; i < 20; i++)
+    {
+      memset(ph, 'a' + i, PAGE_SIZE);
+      if (writeBlock (work->thread, work->fh, ph) != RC_OK || syncPageFile (work->fh) != RC_OK)
+        work->failures++;
+    }
+  free(ph);
+  return NULL;
+}
+
+/* Threads syncing one handle at the same time all get their writes made durable */
+void
+testGroupCommit(void)
+{
+  SM_FileOptions options = { .checksums = 1 };
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  pthread_t threads[CONCURRENT_THREADS];
+  ConcurrentWork work[CONCURRENT_THREADS];
+  int i;
+
+  testName = "test group commit";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  ASSERT_ERROR(syncPageFile (NULL), "a handle that is not open cannot be synced");
+  TEST_CHECK(createPageFileOptions (TESTPF, &options));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (CONCURRENT_THREADS, &fh));
+  TEST_CHECK(syncPageFile (&fh));
+  ASSERT_ERROR(setGroupCommitDelay (&fh, -1), "negative delay is refused");
+  TEST_CHECK(setGroupCommitDelay (&fh, 500));
+
+  for (i = 0; i < CONCURRENT_THREADS; i++)
+    {
+      work[i].fh = &fh;
+      work[i].thread = i;
+      work[i].failures = 0;
+      ASSERT_TRUE(pthread_create(&threads[i], NULL, syncWorker, &work[i]) == 0, "thread started");
+    }
+  for (i = 0; i < CONCURRENT_THREADS; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(0, work[i].failures, "every write and sync of the thread succeeded");
+    }
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < CONCURRENT_THREADS; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE(ph[0] == 'a' + 19, "last write of every thread is there");
+    }
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // Nothing to make durable for a memory file, syncing it still succeeds
+  TEST_CHECK(createPageFile (SM_MEMORY_PREFIX "test_pagefile"));
+  TEST_CHECK(openPageFile (SM_MEMORY_PREFIX "test_pagefile", &fh));
+  TEST_CHECK(syncPageFile (&fh));
+  ASSERT_ERROR(setGroupCommitDelay (&fh, 500), "group commit delay is a file backend setting");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (SM_MEMORY_PREFIX "test_pagefile"));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* testFailedGroupCommit steers the syncs of the storage manager through this fdatasync, following
+ * a plan with one step per sync. Only the first descriptor synced is interfered with, the sidecars
+ * of the file go straight to the kernel. Syncs past the end of the plan succeed. */
+typedef enum SyncStep {
+  SYNC_OK,          // succeeds
+  SYNC_FAIL,        // fails with EIO
+  SYNC_HOLD,        // waits for syncGate, then succeeds
+  SYNC_STALL_OK,    // holds the waiter that did not lead the sync in a signal handler, then succeeds
+  SYNC_STALL_FAIL   // same, then fails
+} SyncStep;
+
+static const SyncStep *syncPlan;
+static int syncPlanLength;
+static int syncFaultRound = -1;       // -1 while fdatasync is not interfered with
+static int syncFaultFd = -1;
+static pthread_t syncWaiters[2];
+static sem_t syncEntered, syncGate, syncStalled, syncStuck, syncRelease;
+
+int
+fdatasync(int fd)
+{
+  if (syncFaultRound < 0 || (syncFaultFd >= 0 && fd != syncFaultFd))
+    return syscall(SYS_fdatasync, fd);
+
+  syncFaultFd = fd;
+  int round = syncFaultRound++;
+  SyncStep step = round < syncPlanLength ? syncPlan[round] : SYNC_OK;
+  switch (step)
+    {
+    case SYNC_HOLD:
+      sem_post(&syncEntered);
+      sem_wait(&syncGate);
+      break;
+    case SYNC_STALL_OK:
+    case SYNC_STALL_FAIL:
+      // Hold the other waiter until a later sync is done. It is given time to go back to waiting
+      // first, held while it still owns the sync lock nothing could complete.
+      usleep(50000);
+      pthread_kill(pthread_equal(pthread_self(), syncWaiters[0]) ? syncWaiters[1] : syncWaiters[0], SIGUSR1);
+      sem_wait(&syncStuck);
+      sem_post(&syncStalled);
+      break;
+    default:
+      break;
+    }
+  if (step == SYNC_FAIL || step == SYNC_STALL_FAIL)
+    {
+      errno = EIO;
+      return -1;
+    }
+  return syscall(SYS_fdatasync, fd);
+}
+
+static void
+holdSyncWaiter(int sig)
+{
+  (void) sig;
+  sem_post(&syncStuck);
+  sem_wait(&syncRelease);
+}
+
+static void *
+failedSyncWorker(void *arg)
+{
+  return (void *) (long) syncPageFile((SM_FileHandle *) arg);
+}
+
+/* A sync held by the plan is led by its own thread until two waiters queue behind it, they share
+ * the next sync and one of them is stalled there. This thread syncs once that sync is done and
+ * releases the stalled waiter afterwards. */
+static void
+runStalledSyncs(SM_FileHandle *fh, RC *leaderRc, RC waiterRc[2], RC *lastRc)
+{
+  pthread_t leader;
+  void *rc;
+  int i;
+
+  ASSERT_TRUE(pthread_create(&leader, NULL, failedSyncWorker, fh) == 0, "leader started");
+  sem_wait(&syncEntered);
+  for (i = 0; i < 2; i++)
+    ASSERT_TRUE(pthread_create(&syncWaiters[i], NULL, failedSyncWorker, fh) == 0, "waiter started");
+  usleep(100000);
+  sem_post(&syncGate);
+
+  sem_wait(&syncStalled);
+  *lastRc = syncPageFile(fh);
+  sem_post(&syncRelease);
+
+  pthread_join(leader, &rc);
+  *leaderRc = (RC) (long) rc;
+  for (i = 0; i < 2; i++)
+    {
+      pthread_join(syncWaiters[i], &rc);
+      waiterRc[i] = (RC) (long) rc;
+    }
+}
+
+/* A caller learns the result of the sync that covered its writes, even when it only gets to look
+ * after later syncs went the other way */
+void
+testFailedGroupCommit(void)
+{
+  const SyncStep failThenSucceed[] = { SYNC_HOLD, SYNC_STALL_FAIL };
+  const SyncStep failSucceedFail[] = { SYNC_FAIL, SYNC_HOLD, SYNC_STALL_OK, SYNC_FAIL };
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct sigaction action, previous;
+  RC leaderRc, waiterRc[2], lastRc;
+
+  testName = "test failed group commit";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  memset(ph, 'f', PAGE_SIZE);
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(writeBlock (0, &fh, ph));
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = holdSyncWaiter;
+  sigaction(SIGUSR1, &action, &previous);
+  sem_init(&syncEntered, 0, 0);
+  sem_init(&syncGate, 0, 0);
+  sem_init(&syncStalled, 0, 0);
+  sem_init(&syncStuck, 0, 0);
+  sem_init(&syncRelease, 0, 0);
+  syncFaultFd = -1;
+
+  // The waiters' sync fails, the stalled one looks after a later sync succeeded
+  syncPlan = failThenSucceed;
+  syncPlanLength = 2;
+  syncFaultRound = 0;
+  runStalledSyncs(&fh, &leaderRc, waiterRc, &lastRc);
+  ASSERT_EQUALS_INT(RC_OK, leaderRc, "first sync succeeded");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, waiterRc[0], "failed sync is reported to the first waiter");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, waiterRc[1], "failed sync is reported to the second waiter");
+  ASSERT_EQUALS_INT(RC_OK, lastRc, "later sync succeeded");
+
+  // The waiters' sync succeeds between two failures, the stalled one looks after the second failure
+  syncPlan = failSucceedFail;
+  syncPlanLength = 4;
+  syncFaultRound = 0;
+  lastRc = syncPageFile(&fh);
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, lastRc, "failed sync is reported");
+  runStalledSyncs(&fh, &leaderRc, waiterRc, &lastRc);
+  ASSERT_EQUALS_INT(RC_OK, leaderRc, "sync after the failure succeeded");
+  ASSERT_EQUALS_INT(RC_OK, waiterRc[0], "successful sync between failures is reported to the first waiter");
+  ASSERT_EQUALS_INT(RC_OK, waiterRc[1], "successful sync between failures is reported to the second waiter");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, lastRc, "later sync failed");
+  TEST_CHECK(syncPageFile (&fh));
+
+  syncFaultRound = -1;
+  sigaction(SIGUSR1, &previous, NULL);
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  sem_destroy(&syncEntered);
+  sem_destroy(&syncGate);
+  sem_destroy(&syncStalled);
+  sem_destroy(&syncStuck);
+  sem_destroy(&syncRelease);
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Every block operation of a handle is counted and timed */
+void
+testFileStats(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_FileStats stats;
+  SM_PageHandle ph;
+  struct stat fileInfo;
+  int i;
+
+  testName = "test file I/O statistics";
+
+  ph = (SM_PageHandle) calloc(1, PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_ERROR(getFileStats (&fh, NULL), "no statistics without a target");
+  TEST_CHECK(getFileStats (&fh, &stats));
+  ASSERT_EQUALS_INT(0, (int) stats.ops[SM_IO_READ].count, "freshly opened handle counted nothing");
+
+  for (i = 0; i < 10; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  for (i = 0; i < 5; i++)
+    TEST_CHECK(readBlock (i, &fh, ph));
+  ASSERT_ERROR(readBlock (100, &fh, ph), "reading past the end fails");
+  TEST_CHECK(appendEmptyBlock (&fh));
+  TEST_CHECK(ensureCapacity (20, &fh));
+  TEST_CHECK(ensureCapacity (5, &fh));
+  TEST_CHECK(syncPageFile (&fh));
+
+  TEST_CHECK(getFileStats (&fh, &stats));
+  ASSERT_EQUALS_INT(6, (int) stats.ops[SM_IO_READ].count, "every read counted");
+  ASSERT_EQUALS_INT(1, (int) stats.ops[SM_IO_READ].errors, "failed read counted");
+  ASSERT_EQUALS_INT(5 * PAGE_SIZE, (int) stats.ops[SM_IO_READ].bytes, "bytes of the reads that succeeded");
+  ASSERT_EQUALS_INT(10, (int) stats.ops[SM_IO_WRITE].count, "every write counted");
+  ASSERT_EQUALS_INT(2, (int) stats.ops[SM_IO_APPEND].count, "appends counted, growing to a smaller size is not");
+  ASSERT_EQUALS_INT(10 * PAGE_SIZE, (int) stats.ops[SM_IO_APPEND].bytes, "bytes appended");
+  ASSERT_EQUALS_INT(1, (int) stats.ops[SM_IO_SYNC].count, "sync counted");
+  ASSERT_TRUE(getLatencyPercentile (&stats.ops[SM_IO_WRITE], 0.5) > 0, "writes took some time");
+  ASSERT_TRUE((getLatencyPercentile (&stats.ops[SM_IO_WRITE], 0.5) <= getLatencyPercentile (&stats.ops[SM_IO_WRITE], 0.99)
+               && getLatencyPercentile (&stats.ops[SM_IO_WRITE], 0.99) <= getLatencyPercentile (&stats.ops[SM_IO_WRITE], 0.999)),
+              "percentiles grow");
+  ASSERT_TRUE(getLatencyPercentile (&stats.ops[SM_IO_SYNC], 1.0) > 0, "sync took some time");
+
+  remove("test_stats.txt");
+  TEST_CHECK(dumpFileStats (&fh, "test_stats.txt"));
+  ASSERT_TRUE((stat("test_stats.txt", &fileInfo) == 0 && fileInfo.st_size > 0), "statistics dumped to a text file");
+  remove("test_stats.txt");
+
+  TEST_CHECK(resetFileStats (&fh));
+  TEST_CHECK(getFileStats (&fh, &stats));
+  ASSERT_EQUALS_INT(0, (int) stats.ops[SM_IO_WRITE].count, "reset starts counting again");
+  TEST_CHECK(closePageFile (&fh));
+
+  // The pool's page file reads show up in the pool's statistics
+  TEST_CHECK(initBufferPool (bm, TESTPF, 3, RS_FIFO, NULL));
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  TEST_CHECK(getPoolFileStats (bm, &stats));
+  ASSERT_EQUALS_INT(getNumReadIO(bm), (int) stats.ops[SM_IO_READ].count, "pool reads are the file's reads");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* bytes of the process's address space mapping the named file, from /proc/self/maps */
+static long
+mappedBytes(const char *fileName)
+{
+  FILE *maps = fopen("/proc/self/maps", "r");
+  char line[512];
+  unsigned long from, to;
+  size_t nameLength = strlen(fileName);
+  long total = 0;
+
+  while (maps != NULL && fgets(line, sizeof(line), maps) != NULL)
+    {
+      size_t length = strlen(line);
+      if (length > nameLength + 1 && line[length - 1] == '\n' && line[length - nameLength - 2] == '/'
+          && strncmp(line + length - nameLength - 1, fileName, nameLength) == 0 && sscanf(line, "%lx-%lx", &from, &to) == 2)
+        total += (long) (to - from);
+    }
+  if (maps != NULL)
+    fclose(maps);
+  return total;
+}
+
+/* Released pages give their disk space back, truncated files shrink */
+void
+testReleasePages(void)
+{
+  SM_FileOptions checksummed = { .checksums = 1 };
+  SM_FileOptions compressed = { .compressed = 1 };
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct stat fileInfo;
+  blkcnt_t blocks;
+  long mapped;
+  int i;
+
+  testName = "test releasing and truncating pages";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFileOptions (TESTPF, &checksummed));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  memset(ph, 'x', PAGE_SIZE);
+  for (i = 0; i < 128; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  TEST_CHECK(syncPageFile (&fh));
+  stat(TESTPF, &fileInfo);
+  blocks = fileInfo.st_blocks;
+
+  ASSERT_ERROR(releasePages (&fh, 100, 40), "released pages have to be in the file");
+  TEST_CHECK(releasePages (&fh, 32, 64));
+  stat(TESTPF, &fileInfo);
+  ASSERT_TRUE(fileInfo.st_blocks < blocks, "released pages take no disk space");
+  ASSERT_EQUALS_INT(128, (int) fh.totalNumPages, "releasing keeps the pages");
+  TEST_CHECK(readBlock (40, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "released page reads back as zeros and passes its checksum");
+  ASSERT_EQUALS_INT(0, (int) nextDataPage (&fh, 0), "first page holds data");
+  ASSERT_EQUALS_INT(96, (int) nextDataPage (&fh, 32), "scan skips the hole");
+
+  TEST_CHECK(freePage (&fh, 100));
+  TEST_CHECK(freePage (&fh, 120));
+  ASSERT_ERROR(truncatePageFile (&fh, 200), "truncating cannot grow the file");
+  TEST_CHECK(truncatePageFile (&fh, 110));
+  ASSERT_EQUALS_INT(110, (int) fh.totalNumPages, "file shrinks");
+  ASSERT_ERROR(readBlock (110, &fh, ph), "pages past the new end are gone");
+  ASSERT_TRUE((isPageFree (&fh, 100) && !isPageFree (&fh, 120)), "free pages past the end are forgotten");
+  ASSERT_EQUALS_INT(110, (int) nextDataPage (&fh, 110), "no data past the end");
+  TEST_CHECK(closePageFile (&fh));
+
+  stat(TESTPF ".crc", &fileInfo);
+  ASSERT_EQUALS_INT(110 * (int) sizeof(uint32_t), (int) fileInfo.st_size, "checksums past the end are dropped");
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(110, (int) fh.totalNumPages, "truncated size survives reopening");
+  ASSERT_TRUE((isPageFree (&fh, 100) && !isPageFree (&fh, 120)), "free page bitmap survives reopening");
+  TEST_CHECK(readBlock (109, &fh, ph));
+  ASSERT_EQUALS_INT('x', ph[0], "pages before the new end stay");
+  TEST_CHECK(writeBlock (110, &fh, ph));
+  ASSERT_EQUALS_INT(111, (int) fh.totalNumPages, "a truncated file grows again");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // Segments past the new end are emptied
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileSegmented (TESTPF, &fh, SM_MODE_PREAD, 16));
+  TEST_CHECK(ensureCapacity (64, &fh));
+  TEST_CHECK(truncatePageFile (&fh, 20));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(20, (int) fh.totalNumPages, "segmented file shrinks");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // A mapped file gives the address space past the new end back
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_MODE_MMAP));
+  for (i = 0; i < 64; i++)
+    {
+      memset(ph, 'a' + i % 26, PAGE_SIZE);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  mapped = mappedBytes(TESTPF);
+  TEST_CHECK(truncatePageFile (&fh, 5));
+  ASSERT_EQUALS_INT(5, (int) fh.totalNumPages, "mapped file shrinks");
+  ASSERT_TRUE(mappedBytes(TESTPF) < mapped && mappedBytes(TESTPF) <= 6 * PAGE_SIZE, "mapping shrinks with the file");
+  TEST_CHECK(readBlock (4, &fh, ph));
+  ASSERT_TRUE((ph[0] == 'e' && ph[PAGE_SIZE - 1] == 'e'), "mapped pages before the new end stay");
+  ASSERT_ERROR(readBlock (5, &fh, ph), "mapped pages past the new end are gone");
+  memset(ph, 'z', PAGE_SIZE);
+  TEST_CHECK(ensureCapacity (7, &fh));
+  TEST_CHECK(writeBlock (7, &fh, ph));
+  ASSERT_EQUALS_INT(8, (int) fh.totalNumPages, "a truncated mapped file grows again");
+  TEST_CHECK(readBlock (6, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "page truncated away reads back as zeros");
+  TEST_CHECK(readBlock (7, &fh, ph));
+  ASSERT_EQUALS_INT('z', ph[0], "page written past the old end reads back");
+  TEST_CHECK(truncatePageFile (&fh, 0));
+  ASSERT_EQUALS_INT(0, (int) fh.totalNumPages, "mapped file empties");
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // Compressed pages give their slots back
+  TEST_CHECK(createPageFileOptions (TESTPF, &compressed));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 32; i++)
+    {
+      memset(ph, 'a' + i % 26, PAGE_SIZE);
+      sprintf(ph, "%d", i);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  TEST_CHECK(releasePages (&fh, 8, 8));
+  TEST_CHECK(readBlock (10, &fh, ph));
+  ASSERT_TRUE((ph[0] == 0 && ph[PAGE_SIZE - 1] == 0), "released compressed page is empty");
+  ASSERT_EQUALS_INT(16, (int) nextDataPage (&fh, 8), "empty compressed pages are skipped");
+  TEST_CHECK(truncatePageFile (&fh, 12));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(12, (int) fh.totalNumPages, "compressed file shrinks");
+  TEST_CHECK(readBlock (7, &fh, ph));
+  ASSERT_TRUE((ph[0] == '7' && ph[PAGE_SIZE - 1] == 'a' + 7), "compressed pages before the new end stay");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Pages a one-shot scan read leave the pool and the page cache behind it, other pages stay */
+void
+testOneShotScan(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  PageNumber *frames;
+  int i, scanned;
+
+  testName = "test one-shot scans";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  memset(ph, 's', PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < 64; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  ASSERT_ERROR(dropPageCache (&fh, 60, 10), "dropped pages have to be in the file");
+  TEST_CHECK(setSequentialHint (&fh, 1));
+  TEST_CHECK(setSequentialHint (&fh, 0));
+  TEST_CHECK(closePageFile (&fh));
+  int cacheDropped = dropCachedPages(TESTPF, 64);
+
+  // Pages 0 to 2 are the working set, a scan reads pages 24 to 53 once. The kernel caches whole
+  // folios, the scan starts past those the working set was read in.
+  TEST_CHECK(initBufferPool (bm, TESTPF, 6, RS_FIFO, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  ASSERT_ERROR(endPoolScan (bm), "no scan to end");
+  TEST_CHECK(beginPoolScan (bm));
+  for (i = 24; i < 54; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      ASSERT_EQUALS_INT('s', h->data[0], "scan reads the page");
+      TEST_CHECK(unpinPage (bm, h));
+      TEST_CHECK(releaseScannedPage (bm, i));
+    }
+  TEST_CHECK(endPoolScan (bm));
+
+  frames = getFrameContents(bm);
+  scanned = 0;
+  for (i = 0; i < 6; i++)
+    scanned += frames[i] >= 24;
+  ASSERT_TRUE((frames[0] == 0 && frames[1] == 1 && frames[2] == 2), "working set stays in the pool");
+  ASSERT_EQUALS_INT(0, scanned, "scanned pages left the pool");
+  free(frames);
+
+  // Only meaningful where the page cache can be emptied
+  if (cacheDropped)
+    {
+      ASSERT_EQUALS_INT(3, residentPages(TESTPF, 0, 3, 0), "working set stays in the page cache");
+      ASSERT_EQUALS_INT(0, residentPages(TESTPF, 24, 30, 0), "scanned pages left the page cache");
+    }
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* A one-shot scan of a table hands each page it read back to the pool once it is past it. Pages
+ * other work pinned or had in the pool before stay, closing the scan ends the pool scan. */
+void
+testOneShotTableScan(void)
+{
+  char *names[] = { "a" };
+  DataType types[] = { DT_INT };
+  int sizes[] = { 0 };
+  int keys[] = { 0 };
+  Schema *schema = createSchema(1, names, types, sizes, 1, keys);
+  RM_TableData table;
+  RM_ScanHandle scan;
+  Record *record;
+  BM_BufferPool *bm;
+  BM_PageHandle *pinned[2] = { MAKE_PAGE_HANDLE(), MAKE_PAGE_HANDLE() };
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  PageNumber *frames;
+  int i, readsBefore, tuples, scanned;
+  RC rc;
+
+  testName = "test one-shot table scans";
+
+  // Page 0 is the table header, pages 1 to 19 are full of records
+  TEST_CHECK(initRecordManager (NULL));
+  TEST_CHECK(createTable ("test_table_s", schema));
+  ph = (SM_PageHandle) calloc(1, PAGE_SIZE);
+  TEST_CHECK(openPageFile ("test_table_s", &fh));
+  for (i = 1; i < 20; i++)
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openTable (&table, "test_table_s"));
+  bm = table.mgmtData->bufferManager;
+
+  // Pages 1 and 2 are the working set and stay pinned, pages 3 and 4 are in the pool already
+  for (i = 0; i < 2; i++)
+    TEST_CHECK(pinPage (bm, pinned[i], i + 1));
+  for (i = 3; i < 5; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+
+  readsBefore = getNumReadIO(bm);
+  TEST_CHECK(createRecord (&record, schema));
+  TEST_CHECK(startOneShotScan (&table, &scan, NULL));
+  tuples = 0;
+  while ((rc = next (&scan, record)) == RC_OK)
+    tuples++;
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ran to the end of the table");
+  ASSERT_EQUALS_INT(19 * table.mgmtData->numRecords, tuples, "every record of the data pages scanned");
+  ASSERT_EQUALS_INT(15, getNumReadIO(bm) - readsBefore, "scan read the pages that were not in the pool");
+  TEST_CHECK(closeScan (&scan));
+  ASSERT_ERROR(endPoolScan (bm), "closing the scan ended the pool scan");
+
+  // 15 pages went through a pool of 10 frames, without the hand-off pages 0, 3 and 4 would be gone
+  frames = getFrameContents(bm);
+  scanned = 0;
+  for (i = 0; i < bm->numPages; i++)
+    scanned += frames[i] >= 5;
+  ASSERT_TRUE((frames[0] == 0 && frames[1] == 1 && frames[2] == 2 && frames[3] == 3 && frames[4] == 4),
+              "working set and the pages in the pool before the scan stay");
+  ASSERT_EQUALS_INT(0, scanned, "the last page scanned left the pool too");
+  free(frames);
+
+  for (i = 0; i < 2; i++)
+    TEST_CHECK(unpinPage (bm, pinned[i]));
+  TEST_CHECK(freeRecord (record));
+  TEST_CHECK(closeTable (&table));
+  TEST_CHECK(shutdownRecordManager ());
+  TEST_CHECK(deleteTable ("test_table_s"));
+  free(table.name);
+  free(table.mgmtData);
+  free(ph);
+  free(pinned[0]);
+  free(pinned[1]);
+  free(h);
+
+  TEST_DONE();
+}
+
+/* Pools larger than the old 1000 frame limit find their pages through the page directory */
+void
+testLargePool(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  PageNumber *frames;
+  int i, present;
+  const int numFrames = 2048;
+  RC rc;
+
+  testName = "test large buffer pool";
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(initBufferPool (bm, TESTPF, numFrames, RS_LRU, NULL));
+  for (i = 0; i < numFrames; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty (bm, h));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  ASSERT_EQUALS_INT(numFrames, getNumReadIO(bm), "every page read once");
+
+  // All pages are in the pool, pinning them again reads nothing
+  for (i = numFrames - 1; i >= 0; i--)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      ASSERT_EQUALS_INT(i, h->pageNum, "page handle of a hit");
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  ASSERT_EQUALS_INT(numFrames, getNumReadIO(bm), "hits read no page");
+  ASSERT_ERROR(unpinPage (bm, h), "page is not pinned any more");
+
+  frames = getFrameContents(bm);
+  ASSERT_TRUE(frames != NULL, "frame contents of a large pool");
+  present = 0;
+  for (i = 0; i < numFrames; i++)
+    present += frames[i] == i;
+  ASSERT_EQUALS_INT(numFrames, present, "pages sit in the frames they were loaded into");
+  free(frames);
+
+  // New pages replace the least recently pinned ones, the highest page numbers after the pass above
+  TEST_CHECK(pinPage (bm, h2, 0));
+  for (i = numFrames; i < numFrames + 100; i++)
+    {
+      TEST_CHECK(pinPage (bm, h, i));
+      TEST_CHECK(unpinPage (bm, h));
+    }
+  ASSERT_EQUALS_INT(100, getNumWriteIO(bm), "replaced dirty pages written back");
+  ASSERT_ERROR(markDirty (bm, &(BM_PageHandle){ .pageNum = numFrames - 1 }), "replaced page left the pool");
+  TEST_CHECK(markDirty (bm, &(BM_PageHandle){ .pageNum = numFrames - 101 }));
+  TEST_CHECK(pinPage (bm, h, numFrames - 1));
+  ASSERT_EQUALS_STRING("Page-2047", h->data, "replaced page read back from disk");
+  TEST_CHECK(unpinPage (bm, h));
+  ASSERT_EQUALS_INT(numFrames + 101, getNumReadIO(bm), "only missing pages are read");
+  TEST_CHECK(unpinPage (bm, h2));
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  // A miss with every frame pinned fails instead of replacing a page in use
+  TEST_CHECK(initBufferPool (bm, TESTPF, 2, RS_FIFO, NULL));
+  TEST_CHECK(pinPage (bm, h, 0));
+  TEST_CHECK(pinPage (bm, h2, 1));
+  rc = pinPage(bm, h, 2);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no frame to replace");
+  TEST_CHECK(unpinPage (bm, h2));
+  TEST_CHECK(pinPage (bm, h2, 2));
+  TEST_CHECK(unpinPage (bm, h2));
+  TEST_CHECK(unpinPage (bm, &(BM_PageHandle){ .pageNum = 0 }));
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(bm);
+  free(h);
+  free(h2);
+
+  TEST_DONE();
+}
+
+/* checks the pages in the frames of a pool */
+static void
+checkFrames(BM_BufferPool *bm, PageNumber *expected, int numFrames, char *message)
+{
+  PageNumber *frames = getFrameContents(bm);
+  int i, same = 1;
+
+  for (i = 0; i < numFrames; i++)
+    same = same && frames[i] == expected[i];
+  ASSERT_TRUE(same, message);
+  free(frames);
+}
+
+/* pins a page and unpins it right away */
+static void
+touchPage(BM_BufferPool *bm, BM_PageHandle *h, PageNumber pageNum)
+{
+  TEST_CHECK(pinPage (bm, h, pageNum));
+  TEST_CHECK(unpinPage (bm, h));
+}
+
+/* CLOCK gives frames pinned since the hand last passed a second chance */
+void
+testClockStrategy(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  int i;
+  RC rc;
+
+  testName = "test CLOCK replacement";
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(initBufferPool (bm, TESTPF, 3, RS_CLOCK, NULL));
+  for (i = 0; i < 3; i++)
+    touchPage(bm, h, i);
+  touchPage(bm, h, 1);
+  ASSERT_EQUALS_INT(3, getNumReadIO(bm), "hit reads nothing");
+
+  // Every frame was used, one full sweep takes the reference bits and the hand comes back to frame 0
+  touchPage(bm, h, 3);
+  checkFrames(bm, (PageNumber[]) { 3, 1, 2 }, 3, "hand replaces the first frame after a full sweep");
+
+  // Page 1 is used again and keeps its frame, page 2 was not
+  touchPage(bm, h, 1);
+  touchPage(bm, h, 4);
+  checkFrames(bm, (PageNumber[]) { 3, 1, 4 }, 3, "used page gets a second chance");
+
+  // The hand passes pinned frames
+  TEST_CHECK(pinPage (bm, h2, 3));
+  touchPage(bm, h, 5);
+  checkFrames(bm, (PageNumber[]) { 3, 5, 4 }, 3, "pinned page stays");
+  TEST_CHECK(pinPage (bm, h, 5));
+  TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, 4));
+  rc = pinPage(bm, &(BM_PageHandle){ 0 }, 6);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no frame to replace");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(bm);
+  free(h);
+  free(h2);
+
+  TEST_DONE();
+}
+
+/* LFU replaces the page pinned least often, aging lets a page that was hot long ago go */
+void
+testLfuStrategy(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  PageNumber *frames;
+  int i, decayPeriod, aged;
+  RC rc;
+
+  testName = "test LFU replacement";
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(initBufferPool (bm, TESTPF, 3, RS_LFU, NULL));
+  for (i = 0; i < 3; i++)
+    touchPage(bm, h, 0);
+  for (i = 0; i < 2; i++)
+    touchPage(bm, h, 1);
+  touchPage(bm, h, 2);
+  touchPage(bm, h, 3);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 3 }, 3, "page pinned once is replaced");
+
+  touchPage(bm, h, 3);
+  touchPage(bm, h, 3);
+  touchPage(bm, h, 4);
+  checkFrames(bm, (PageNumber[]) { 0, 4, 3 }, 3, "page pinned twice is replaced before pages pinned three times");
+  touchPage(bm, h, 5);
+  checkFrames(bm, (PageNumber[]) { 0, 5, 3 }, 3, "new page is pinned least often");
+
+  // Page 5 is in use, of the pages pinned three times page 0 got there first
+  TEST_CHECK(pinPage (bm, h2, 5));
+  touchPage(bm, h, 6);
+  checkFrames(bm, (PageNumber[]) { 6, 5, 3 }, 3, "pinned page stays, oldest of equal counts leaves");
+  TEST_CHECK(pinPage (bm, h, 6));
+  TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, 3));
+  rc = pinPage(bm, &(BM_PageHandle){ 0 }, 7);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no frame to replace");
+  TEST_CHECK(unpinPage (bm, h));
+  TEST_CHECK(unpinPage (bm, &(BM_PageHandle){ .pageNum = 3 }));
+  TEST_CHECK(unpinPage (bm, h2));
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "hits read nothing");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  // Page 0 is hot at first, then every pin is for a new page. Without aging page 0 stays for good.
+  for (decayPeriod = 0; decayPeriod <= 8; decayPeriod += 8)
+    {
+      TEST_CHECK(initBufferPool (bm, TESTPF, 2, RS_LFU, &decayPeriod));
+      for (i = 0; i < 6; i++)
+        touchPage(bm, h, 0);
+      for (i = 1; i <= 20; i++)
+        touchPage(bm, h, i);
+      frames = getFrameContents(bm);
+      aged = frames[0] != 0 && frames[1] != 0;
+      free(frames);
+      if (decayPeriod == 0)
+        ASSERT_TRUE(!aged, "hot page stays without aging");
+      else
+        ASSERT_TRUE(aged, "hot page leaves once its count aged");
+      TEST_CHECK(shutdownBufferPool (bm));
+    }
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(bm);
+  free(h);
+  free(h2);
+
+  TEST_DONE();
+}
+
+/* LRU-K replaces the page whose K-th last pin is the furthest back, pages read once go first */
+void
+testLruKStrategy(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  const int orderRequests[] = { 3, 4, 0, 2, 1 };
+  int i, k;
+  RC rc;
+
+  testName = "test LRU-K replacement";
+
+  TEST_CHECK(createPageFile (TESTPF));
+
+  // With K = 1 this is LRU
+  k = 1;
+  TEST_CHECK(initBufferPool (bm, TESTPF, 5, RS_LRU_K, &k));
+  for (i = 0; i < 5; i++)
+    touchPage(bm, h, i);
+  for (i = 0; i < 5; i++)
+    touchPage(bm, h, orderRequests[i]);
+  touchPage(bm, h, 5);
+  touchPage(bm, h, 6);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 2, 5, 6 }, 5, "K = 1 replaces the least recently pinned pages");
+  touchPage(bm, h, 7);
+  touchPage(bm, h, 8);
+  touchPage(bm, h, 9);
+  checkFrames(bm, (PageNumber[]) { 7, 9, 8, 5, 6 }, 5, "K = 1 replaces pages in LRU order");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "hits read nothing");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  // With the default K = 2, pages pinned twice outlast a scan reading every page once
+  TEST_CHECK(initBufferPool (bm, TESTPF, 4, RS_LRU_K, NULL));
+  for (i = 0; i < 2; i++)
+    {
+      touchPage(bm, h, 0);
+      touchPage(bm, h, 1);
+    }
+  for (i = 10; i < 40; i++)
+    touchPage(bm, h, i);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 38, 39 }, 4, "working set outlasts the scan");
+
+  // The page to replace next is pinned and set aside
+  TEST_CHECK(pinPage (bm, h2, 38));
+  touchPage(bm, h, 40);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 38, 40 }, 4, "pinned page stays");
+
+  // With every frame pinned a miss fails, the frames set aside are back in the heap after it
+  for (i = 0; i < 2; i++)
+    TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, i));
+  TEST_CHECK(pinPage (bm, h, 40));
+  rc = pinPage(bm, &(BM_PageHandle){ 0 }, 41);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no frame to replace");
+  TEST_CHECK(unpinPage (bm, h));
+  for (i = 0; i < 2; i++)
+    TEST_CHECK(unpinPage (bm, &(BM_PageHandle){ .pageNum = i }));
+  touchPage(bm, h, 41);
+  checkFrames(bm, (PageNumber[]) { 41, 1, 38, 40 }, 4, "replacement goes on after a failed miss");
+  TEST_CHECK(unpinPage (bm, h2));
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  // Page 1 leaves the pool after one pin, its history counts the pin when it is read again
+  TEST_CHECK(initBufferPool (bm, TESTPF, 3, RS_LRU_K, NULL));
+  touchPage(bm, h, 0);
+  touchPage(bm, h, 0);
+  touchPage(bm, h, 1);
+  touchPage(bm, h, 2);
+  touchPage(bm, h, 3);
+  checkFrames(bm, (PageNumber[]) { 0, 3, 2 }, 3, "page pinned once replaced");
+  touchPage(bm, h, 1);
+  touchPage(bm, h, 4);
+  touchPage(bm, h, 5);
+  checkFrames(bm, (PageNumber[]) { 0, 5, 1 }, 3, "page read again keeps its history");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(bm);
+  free(h);
+  free(h2);
+
+  TEST_DONE();
+}
+
+/* ARC keeps pages pinned more than once through a scan and grows the share of pages pinned once
+ * when pages come back soon after they were replaced */
+void
+testArcStrategy(void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  int i;
+  RC rc;
+
+  testName = "test ARC replacement";
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(initBufferPool (bm, TESTPF, 4, RS_ARC, NULL));
+  for (i = 0; i < 2; i++)
+    {
+      touchPage(bm, h, 0);
+      touchPage(bm, h, 1);
+    }
+  for (i = 10; i < 30; i++)
+    touchPage(bm, h, i);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 28, 29 }, 4, "pages pinned twice outlast the scan");
+  ASSERT_EQUALS_INT(22, getNumReadIO(bm), "hits read nothing");
+
+  // Page 27 was replaced a moment ago, reading it again makes room for more pages pinned once
+  touchPage(bm, h, 27);
+  checkFrames(bm, (PageNumber[]) { 0, 1, 27, 29 }, 4, "scan page replaced for a page coming back");
+  touchPage(bm, h, 30);
+  checkFrames(bm, (PageNumber[]) { 30, 1, 27, 29 }, 4, "pages pinned once get more frames");
+
+  // Pinning page 29 again moves it to the pages pinned more than once, of those page 1 is the oldest
+  TEST_CHECK(pinPage (bm, h2, 29));
+  touchPage(bm, h, 31);
+  checkFrames(bm, (PageNumber[]) { 30, 31, 27, 29 }, 4, "oldest page pinned more than once replaced");
+
+  // A miss with every frame pinned fails
+  TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, 31));
+  TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, 30));
+  TEST_CHECK(pinPage (bm, &(BM_PageHandle){ 0 }, 27));
+  rc = pinPage(bm, h, 32);
+  ASSERT_EQUALS_INT(RC_ALL_FRAMES_PINNED, rc, "no frame to replace");
+  TEST_CHECK(shutdownBufferPool (bm));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(bm);
+  free(h);
+  free(h2);
+
+  TEST_DONE();
+}